@@ -22,18 +22,39 @@ region_t get_damage(session_t *ps) {
 	int buffer_age = buffer_age_fn ? buffer_age_fn(ps->backend_data, ps) : -1;
 
 	pixman_region32_init(&region);
-	if (buffer_age == -1 || buffer_age > ps->ndamage) {
-		pixman_region32_copy(&region, &ps->screen_reg);
-	} else {
-		for (int i = 0; i < buffer_age; i++) {
-			const int curr = ((ps->damage - ps->damage_ring) + i) % ps->ndamage;
-			pixman_region32_union(&region, &region, &ps->damage_ring[curr]);
-		}
+	if (damage_history_get(&ps->damage, buffer_age, &region)) {
 		pixman_region32_intersect(&region, &region, &ps->screen_reg);
+	} else {
+		pixman_region32_copy(&region, &ps->screen_reg);
 	}
 	return region;
 }
 
+/// Free the data of mapped windows and the backend's own resources, until
+/// backend_resume() is called
+void backend_pause(session_t *ps) {
+	auto bi = backend_list[ps->o.backend];
+	// Windows fading out keep their data, it can't be prepared again
+	for (win *w = ps->list; w; w = w->next) {
+		if (w->win_data && w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+			bi->release_win(ps->backend_data, ps, w, w->win_data);
+			w->win_data = NULL;
+		}
+	}
+	if (bi->pause)
+		bi->pause(ps->backend_data, ps);
+}
+
+/// Recreate what backend_pause() freed
+void backend_resume(session_t *ps) {
+	auto bi = backend_list[ps->o.backend];
+	if (bi->resume)
+		bi->resume(ps->backend_data, ps);
+	for (win *w = ps->list; w; w = w->next)
+		if (!w->win_data && w->a.map_state == XCB_MAP_STATE_VIEWABLE)
+			w->win_data = bi->prepare_win(ps->backend_data, ps, w);
+}
+
 /// paint all windows
 void paint_all_new(session_t *ps, win *const t, bool ignore_damage) {
 	region_t region;
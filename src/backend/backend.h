@@ -157,5 +157,7 @@ extern backend_info_t *backend_list[];
 bool default_is_win_transparent(void *, win *, void *);
 bool default_is_frame_transparent(void *, win *, void *);
 void paint_all_new(session_t *ps, win *const t, bool ignore_damage) attr_nonnull(1);
+void backend_pause(session_t *ps) attr_nonnull(1);
+void backend_resume(session_t *ps) attr_nonnull(1);
 
 // vim: set noet sw=8 ts=8 :
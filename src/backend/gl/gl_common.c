@@ -2,10 +2,14 @@
 // Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
 #include <GL/gl.h>
 #include <GL/glext.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <locale.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <xcb/render.h>        // for xcb_render_fixed_t, XXX
 
 #include "common.h"
@@ -80,7 +84,13 @@ end:
 	return shader;
 }
 
-GLuint gl_create_program(const GLuint *const shaders, int nshaders) {
+/**
+ * @brief Link a program from compiled shaders.
+ *
+ * @param retrievable whether we want to read the program binary back with
+ *                    glGetProgramBinary
+ */
+GLuint gl_create_program(const GLuint *const shaders, int nshaders, bool retrievable) {
 	bool success = false;
 	GLuint program = glCreateProgram();
 	if (!program) {
@@ -88,6 +98,9 @@ GLuint gl_create_program(const GLuint *const shaders, int nshaders) {
 		goto end;
 	}
 
+	if (retrievable)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	for (int i = 0; i < nshaders; ++i)
 		glAttachShader(program, shaders[i]);
 	glLinkProgram(program);
@@ -122,10 +135,308 @@ end:
 	return program;
 }
 
+#define GL_PROGRAM_CACHE_MAGIC 0x47525043        // "CPRG"
+#define GL_PROGRAM_CACHE_VERSION 2
+
+/// Header of a program binary cache file, followed by `sources_length` bytes of
+/// what the program was built from, see gl_program_cache_sources(), then `length`
+/// bytes of binary.
+struct gl_program_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	/// Hash of the driver strings and shader sources, which names the file.
+	uint64_t key;
+	/// How long compiling and linking this program took originally.
+	uint64_t compile_ns;
+	/// Binary format, as returned by glGetProgramBinary.
+	uint32_t format;
+	uint32_t length;
+	uint32_t sources_length;
+	uint32_t pad;
+};
+
+/// State of the on-disk program binary cache. There is only one GL context alive at
+/// any time, so this is global.
+static struct {
+	bool enabled;
+	/// Directory holding the cache files, with trailing slash.
+	char *dir;
+	/// Hash of GL vendor, renderer and version strings.
+	uint64_t driver_hash;
+	/// Number of programs loaded from the cache.
+	unsigned int hits;
+	/// Number of programs compiled from source.
+	unsigned int misses;
+	/// Sum of the original compile time of programs loaded from the cache.
+	uint64_t saved_ns;
+	/// Time spent loading programs from the cache.
+	uint64_t load_ns;
+	/// Time spent compiling programs.
+	uint64_t compile_ns;
+} gl_program_cache;
+
+static inline uint64_t gl_program_cache_now(void) {
+	struct timespec now = get_time_timespec();
+	return (uint64_t)now.tv_sec * NS_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+/// FNV-1a hash of a string, including its terminating NUL so consecutive strings
+/// can't be confused with each other. NULL hashes differently from "".
+static uint64_t gl_program_cache_hash(uint64_t hash, const char *str) {
+	const uint64_t prime = 0x100000001b3ULL;
+	if (!str) {
+		hash ^= 0xff;
+		return hash * prime;
+	}
+	do {
+		hash ^= (unsigned char)*str;
+		hash *= prime;
+	} while (*str++);
+	return hash;
+}
+
+/// Create every missing component of `path`. `path` must end with a slash.
+static bool gl_program_cache_mkdir(char *path) {
+	for (char *p = path + 1; *p; p++) {
+		if (*p != '/')
+			continue;
+		*p = '\0';
+		int ret = mkdir(path, 0700);
+		*p = '/';
+		if (ret && errno != EEXIST)
+			return false;
+	}
+	return true;
+}
+
 /**
- * @brief Create a program from vertex and fragment shader strings.
+ * Initialize the program binary cache. Must be called with a current GL context.
+ *
+ * Cache files live in `$XDG_CACHE_HOME/compton/programs/`, and are keyed by the GL
+ * driver strings and the shader sources. Kernel weights are baked into the blur
+ * shader sources, so they are part of the key too.
  */
-GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_shader_str) {
+void gl_program_cache_init(bool enabled) {
+	gl_program_cache_deinit();
+	if (!enabled)
+		return;
+
+	GLint nformats = 0;
+	if (gl_has_extension("GL_ARB_get_program_binary"))
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nformats);
+	if (nformats <= 0) {
+		log_info("Driver can't save program binaries, program cache disabled.");
+		return;
+	}
+
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	char *dir = NULL;
+	if (cache_home && *cache_home == '/') {
+		dir = mstrjoin(cache_home, "/compton/programs/");
+	} else {
+		const char *home = getenv("HOME");
+		if (!home || *home != '/') {
+			log_info("Can't find a cache directory, program cache disabled.");
+			return;
+		}
+		dir = mstrjoin(home, "/.cache/compton/programs/");
+	}
+	if (!gl_program_cache_mkdir(dir)) {
+		log_warn("Failed to create program cache directory %s: %s", dir,
+		         strerror(errno));
+		free(dir);
+		return;
+	}
+
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = gl_program_cache_hash(hash, (const char *)glGetString(GL_VENDOR));
+	hash = gl_program_cache_hash(hash, (const char *)glGetString(GL_RENDERER));
+	hash = gl_program_cache_hash(hash, (const char *)glGetString(GL_VERSION));
+
+	gl_program_cache.enabled = true;
+	gl_program_cache.dir = dir;
+	gl_program_cache.driver_hash = hash;
+	log_debug("Program cache directory: %s", dir);
+}
+
+void gl_program_cache_deinit(void) {
+	free(gl_program_cache.dir);
+	memset(&gl_program_cache, 0, sizeof(gl_program_cache));
+}
+
+/**
+ * Log how many programs were loaded from the cache, and how much time that saved.
+ * The counters are reset afterwards.
+ */
+void gl_program_cache_report(void) {
+	if (!gl_program_cache.hits && !gl_program_cache.misses)
+		return;
+
+	uint64_t saved = 0;
+	if (gl_program_cache.saved_ns > gl_program_cache.load_ns)
+		saved = gl_program_cache.saved_ns - gl_program_cache.load_ns;
+	log_info("GL programs: %u loaded from cache in %.2f ms (saved about %.2f ms), "
+	         "%u compiled in %.2f ms",
+	         gl_program_cache.hits, gl_program_cache.load_ns / 1e6, saved / 1e6,
+	         gl_program_cache.misses, gl_program_cache.compile_ns / 1e6);
+	gl_program_cache.hits = gl_program_cache.misses = 0;
+	gl_program_cache.saved_ns = gl_program_cache.load_ns = 0;
+	gl_program_cache.compile_ns = 0;
+}
+
+/// Write a string into the sources of a cache file, NUL terminated. NULL is written
+/// as a lone 0xff byte, which can't start a string.
+static void gl_program_cache_put_string(FILE *f, const char *str) {
+	if (str)
+		fwrite(str, strlen(str) + 1, 1, f);
+	else
+		fputc(0xff, f);
+}
+
+/// Everything a program depends on: the GL driver strings and the shader sources.
+/// Cache files hold them in full, so a hash collision can't load the wrong
+/// program. Caller frees.
+static char *gl_program_cache_sources(const char *vert_shader_str,
+                                      const char *frag_shader_str, size_t *len) {
+	char *buf = NULL;
+	FILE *f = open_memstream(&buf, len);
+	if (!f)
+		return NULL;
+	gl_program_cache_put_string(f, (const char *)glGetString(GL_VENDOR));
+	gl_program_cache_put_string(f, (const char *)glGetString(GL_RENDERER));
+	gl_program_cache_put_string(f, (const char *)glGetString(GL_VERSION));
+	gl_program_cache_put_string(f, vert_shader_str);
+	gl_program_cache_put_string(f, frag_shader_str);
+	if (fclose(f)) {
+		free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+/// Path of the cache file for a program with the given key. Caller frees.
+static char *gl_program_cache_path(uint64_t key) {
+	char name[sizeof(uint64_t) * 2 + sizeof(".bin")];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".bin", key);
+	return mstrjoin(gl_program_cache.dir, name);
+}
+
+/// Try to create a program from the cache file for `key`, if it was built from
+/// `sources`. Returns 0 on miss.
+static GLuint gl_program_cache_load(uint64_t key, const char *sources,
+                                    size_t sources_length, uint64_t *compile_ns) {
+	char *path = gl_program_cache_path(key);
+	FILE *f = fopen(path, "rb");
+	GLuint prog = 0;
+	void *binary = NULL;
+	if (!f)
+		goto end;
+
+	struct gl_program_cache_header hdr;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != GL_PROGRAM_CACHE_MAGIC ||
+	    hdr.version != GL_PROGRAM_CACHE_VERSION || hdr.key != key || !hdr.length)
+		goto invalid;
+
+	if (hdr.sources_length != sources_length)
+		goto collision;
+	binary = cvalloc(max_l(hdr.length, (long)sources_length));
+	if (fread(binary, sources_length, 1, f) != 1)
+		goto invalid;
+	if (memcmp(binary, sources, sources_length) != 0)
+		goto collision;
+
+	if (fread(binary, hdr.length, 1, f) != 1)
+		goto invalid;
+
+	prog = glCreateProgram();
+	if (!prog)
+		goto end;
+	glProgramBinary(prog, hdr.format, binary, (GLsizei)hdr.length);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(prog, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		// Most likely the driver was updated without changing its version
+		// string. Drop the stale file, it will be regenerated.
+		glDeleteProgram(prog);
+		prog = 0;
+		goto invalid;
+	}
+	*compile_ns = hdr.compile_ns;
+	goto end;
+
+collision:
+	// Another program hashes to the same key. It is compiled from source, and
+	// takes over the file.
+	log_debug("Program cache file %s is for different shaders", path);
+	goto end;
+invalid:
+	log_debug("Removing invalid program cache file %s", path);
+	unlink(path);
+end:
+	if (f)
+		fclose(f);
+	free(binary);
+	free(path);
+	// glProgramBinary is allowed to fail with GL_INVALID_ENUM if the format is
+	// no longer supported, don't let that leak into later error checks
+	while (glGetError() != GL_NO_ERROR)
+		;
+	return prog;
+}
+
+/// Write the binary of `prog`, built from `sources`, into the cache file for `key`.
+static void gl_program_cache_store(uint64_t key, const char *sources,
+                                   size_t sources_length, GLuint prog,
+                                   uint64_t compile_ns) {
+	GLint length = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	struct gl_program_cache_header hdr = {
+	    .magic = GL_PROGRAM_CACHE_MAGIC,
+	    .version = GL_PROGRAM_CACHE_VERSION,
+	    .key = key,
+	    .compile_ns = compile_ns,
+	    .sources_length = (uint32_t)sources_length,
+	};
+	void *binary = cvalloc(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(prog, length, &written, &format, binary);
+	if (written <= 0) {
+		free(binary);
+		return;
+	}
+	hdr.format = format;
+	hdr.length = (uint32_t)written;
+
+	// Write to a temporary file first, so a concurrent reader never sees a
+	// truncated binary
+	char *path = gl_program_cache_path(key);
+	char *tmp_path = mstrjoin(path, ".tmp");
+	FILE *f = fopen(tmp_path, "wb");
+	bool success = f && fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+	               fwrite(sources, sources_length, 1, f) == 1 &&
+	               fwrite(binary, hdr.length, 1, f) == 1;
+	if (f && fclose(f))
+		success = false;
+	if (success && rename(tmp_path, path) == 0)
+		log_debug("Saved program binary to %s", path);
+	else {
+		log_debug("Failed to save program binary to %s", path);
+		unlink(tmp_path);
+	}
+
+	free(tmp_path);
+	free(path);
+	free(binary);
+}
+
+static GLuint
+gl_create_program_from_str_uncached(const char *vert_shader_str,
+                                    const char *frag_shader_str, bool retrievable) {
 	GLuint vert_shader = 0;
 	GLuint frag_shader = 0;
 	GLuint prog = 0;
@@ -144,7 +455,7 @@ GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_
 			shaders[count++] = frag_shader;
 		assert(count <= sizeof(shaders) / sizeof(shaders[0]));
 		if (count)
-			prog = gl_create_program(shaders, count);
+			prog = gl_create_program(shaders, count, retrievable);
 	}
 
 	if (vert_shader)
@@ -155,6 +466,52 @@ GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_
 	return prog;
 }
 
+/**
+ * @brief Create a program from vertex and fragment shader strings.
+ *
+ * The linked program is loaded from, or saved to, the program binary cache when
+ * it is enabled.
+ */
+GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_shader_str) {
+	uint64_t start = gl_program_cache_now();
+	if (!gl_program_cache.enabled)
+		return gl_create_program_from_str_uncached(vert_shader_str,
+		                                           frag_shader_str, false);
+
+	uint64_t key = gl_program_cache.driver_hash;
+	key = gl_program_cache_hash(key, vert_shader_str);
+	key = gl_program_cache_hash(key, frag_shader_str);
+
+	size_t sources_length = 0;
+	char *sources =
+	    gl_program_cache_sources(vert_shader_str, frag_shader_str, &sources_length);
+	if (!sources || sources_length > UINT32_MAX) {
+		free(sources);
+		return gl_create_program_from_str_uncached(vert_shader_str,
+		                                           frag_shader_str, false);
+	}
+
+	uint64_t compile_ns = 0;
+	GLuint prog = gl_program_cache_load(key, sources, sources_length, &compile_ns);
+	if (prog) {
+		gl_program_cache.hits++;
+		gl_program_cache.saved_ns += compile_ns;
+		gl_program_cache.load_ns += gl_program_cache_now() - start;
+		free(sources);
+		return prog;
+	}
+
+	prog = gl_create_program_from_str_uncached(vert_shader_str, frag_shader_str, true);
+	if (prog) {
+		compile_ns = gl_program_cache_now() - start;
+		gl_program_cache.misses++;
+		gl_program_cache.compile_ns += compile_ns;
+		gl_program_cache_store(key, sources, sources_length, prog, compile_ns);
+	}
+	free(sources);
+	return prog;
+}
+
 void gl_free_prog_main(session_t *ps, gl_win_shader_t *pprogram) {
 	if (!pprogram)
 		return;
@@ -537,6 +894,340 @@ end:
 	return ret;
 }
 
+/// Program and uniforms of one dual-Kawase pass
+typedef struct {
+	GLuint prog;
+	/// Location of uniform "halfpixel", half a texel of the source texture.
+	GLint unifm_halfpixel;
+	/// Location of uniform "uv_max", the extent of valid source content.
+	GLint unifm_uv_max;
+	/// Location of uniform "offset", the sample distance.
+	GLint unifm_offset;
+} gl_kawase_shader_t;
+
+/// State of the dual-Kawase blur, shared by every blurred window. Level 0 holds
+/// the area to blur at full resolution, level i is downscaled by 2^i. The
+/// textures are sized for the whole screen, so they are only reallocated when
+/// the screen size changes.
+struct gl_kawase_blur {
+	gl_kawase_shader_t down;
+	gl_kawase_shader_t up;
+	GLuint fbo;
+	GLuint textures[MAX_BLUR_ITERATIONS + 1];
+	/// Screen size the textures are allocated for.
+	int width, height;
+	int iterations;
+	double strength;
+};
+
+// The source is sampled with bilinear filtering, so each fetch averages 4
+// texels. Fetches are clamped to the valid area, because the textures are
+// shared and contain stale content elsewhere.
+#define KAWASE_SHADER_PREFIX                                                             \
+	"#version 110\n"                                                                 \
+	"uniform sampler2D tex_src;\n"                                                   \
+	"uniform vec2 halfpixel;\n"                                                      \
+	"uniform vec2 uv_max;\n"                                                         \
+	"uniform float offset;\n"                                                        \
+	"vec4 fetch(vec2 uv) {\n"                                                        \
+	"  return texture2D(tex_src, clamp(uv, halfpixel, uv_max - halfpixel));\n"       \
+	"}\n"
+
+static const char *const KAWASE_DOWN_SHADER =
+    KAWASE_SHADER_PREFIX
+    "void main() {\n"
+    "  vec2 uv = gl_TexCoord[0].xy;\n"
+    "  vec2 d = halfpixel * offset;\n"
+    "  vec4 sum = fetch(uv) * 4.0;\n"
+    "  sum += fetch(uv - d);\n"
+    "  sum += fetch(uv + d);\n"
+    "  sum += fetch(uv + vec2(d.x, -d.y));\n"
+    "  sum += fetch(uv - vec2(d.x, -d.y));\n"
+    "  gl_FragColor = sum / 8.0;\n"
+    "}\n";
+
+static const char *const KAWASE_UP_SHADER =
+    KAWASE_SHADER_PREFIX
+    "void main() {\n"
+    "  vec2 uv = gl_TexCoord[0].xy;\n"
+    "  vec2 d = halfpixel * offset;\n"
+    "  vec4 sum = fetch(uv + vec2(-d.x * 2.0, 0.0));\n"
+    "  sum += fetch(uv + vec2(-d.x, d.y)) * 2.0;\n"
+    "  sum += fetch(uv + vec2(0.0, d.y * 2.0));\n"
+    "  sum += fetch(uv + vec2(d.x, d.y)) * 2.0;\n"
+    "  sum += fetch(uv + vec2(d.x * 2.0, 0.0));\n"
+    "  sum += fetch(uv + vec2(d.x, -d.y)) * 2.0;\n"
+    "  sum += fetch(uv + vec2(0.0, -d.y * 2.0));\n"
+    "  sum += fetch(uv + vec2(-d.x, -d.y)) * 2.0;\n"
+    "  gl_FragColor = sum / 12.0;\n"
+    "}\n";
+
+#undef KAWASE_SHADER_PREFIX
+
+static bool gl_kawase_shader_init(gl_kawase_shader_t *shader, const char *shader_str) {
+	shader->prog = gl_create_program_from_str(NULL, shader_str);
+	if (!shader->prog) {
+		log_error("Failed to create dual-Kawase blur program.");
+		return false;
+	}
+	shader->unifm_halfpixel = glGetUniformLocation(shader->prog, "halfpixel");
+	shader->unifm_uv_max = glGetUniformLocation(shader->prog, "uv_max");
+	shader->unifm_offset = glGetUniformLocation(shader->prog, "offset");
+	return true;
+}
+
+/// Size of a level of the mip chain, for a level 0 of `size`.
+static inline int gl_kawase_level_size(int size, int level) {
+	return max_i((size + (1 << level) - 1) >> level, 1);
+}
+
+void gl_kawase_blur_free(struct gl_kawase_blur *kb) {
+	if (!kb)
+		return;
+	if (kb->down.prog)
+		glDeleteProgram(kb->down.prog);
+	if (kb->up.prog)
+		glDeleteProgram(kb->up.prog);
+	if (kb->fbo)
+		glDeleteFramebuffers(1, &kb->fbo);
+	glDeleteTextures(ARR_SIZE(kb->textures), kb->textures);
+	free(kb);
+}
+
+/**
+ * Create the programs and framebuffer of a dual-Kawase blur. Textures are
+ * allocated on first use.
+ */
+struct gl_kawase_blur *gl_kawase_blur_new(int iterations, double strength) {
+	assert(iterations >= 1 && iterations <= MAX_BLUR_ITERATIONS);
+
+	auto kb = ccalloc(1, struct gl_kawase_blur);
+	kb->iterations = iterations;
+	kb->strength = strength;
+	if (!gl_kawase_shader_init(&kb->down, KAWASE_DOWN_SHADER) ||
+	    !gl_kawase_shader_init(&kb->up, KAWASE_UP_SHADER))
+		goto err;
+
+	glGenFramebuffers(1, &kb->fbo);
+	if (!kb->fbo) {
+		log_error("Failed to generate framebuffer for dual-Kawase blur.");
+		goto err;
+	}
+
+	gl_check_err();
+	return kb;
+
+err:
+	gl_kawase_blur_free(kb);
+	return NULL;
+}
+
+/// (Re)allocate the mip chain for a screen of the given size.
+static bool gl_kawase_resize(struct gl_kawase_blur *kb, int width, int height) {
+	if (kb->width == width && kb->height == height)
+		return true;
+
+	glDeleteTextures(ARR_SIZE(kb->textures), kb->textures);
+	memset(kb->textures, 0, sizeof(kb->textures));
+	kb->width = kb->height = 0;
+	for (int i = 0; i <= kb->iterations; i++) {
+		if (gl_gen_texture(GL_TEXTURE_2D, gl_kawase_level_size(width, i),
+		                   gl_kawase_level_size(height, i), &kb->textures[i])) {
+			log_error("Failed to allocate texture for dual-Kawase blur.");
+			return false;
+		}
+	}
+	kb->width = width;
+	kb->height = height;
+	return true;
+}
+
+/**
+ * Free the textures of a dual-Kawase blur, they are allocated again on next
+ * use.
+ */
+void gl_kawase_blur_release(struct gl_kawase_blur *kb) {
+	glDeleteTextures(ARR_SIZE(kb->textures), kb->textures);
+	memset(kb->textures, 0, sizeof(kb->textures));
+	kb->width = kb->height = 0;
+}
+
+/// Size of the textures of a dual-Kawase blur, in bytes.
+size_t gl_kawase_blur_texture_bytes(const struct gl_kawase_blur *kb) {
+	size_t ret = 0;
+	for (int i = 0; kb->width && i <= kb->iterations; i++)
+		ret += (size_t)gl_kawase_level_size(kb->width, i) *
+		       (size_t)gl_kawase_level_size(kb->height, i) * 4;
+	return ret;
+}
+
+/// Set up the program of a pass that samples `w` x `h` of level `src`.
+static void gl_kawase_use(const struct gl_kawase_blur *kb, const gl_kawase_shader_t *shader,
+                          int src, int w, int h) {
+	const int tw = gl_kawase_level_size(kb->width, src),
+	          th = gl_kawase_level_size(kb->height, src);
+	glUseProgram(shader->prog);
+	if (shader->unifm_halfpixel >= 0)
+		glUniform2f(shader->unifm_halfpixel, 0.5f / tw, 0.5f / th);
+	if (shader->unifm_uv_max >= 0)
+		glUniform2f(shader->unifm_uv_max, (GLfloat)w / tw, (GLfloat)h / th);
+	if (shader->unifm_offset >= 0)
+		glUniform1f(shader->unifm_offset, (GLfloat)kb->strength);
+	glBindTexture(GL_TEXTURE_2D, kb->textures[src]);
+}
+
+/// Render level `src` into level `dst`. `lw` and `lh` are the sizes of the
+/// valid content of each level.
+static bool gl_kawase_pass(const struct gl_kawase_blur *kb, const gl_kawase_shader_t *shader,
+                           int src, int dst, const int *lw, const int *lh) {
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+	                       kb->textures[dst], 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		log_error("Framebuffer attachment failed.");
+		return false;
+	}
+
+	const int tw = gl_kawase_level_size(kb->width, dst),
+	          th = gl_kawase_level_size(kb->height, dst);
+	glViewport(0, 0, tw, th);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, tw, 0, th, -1000.0, 1000.0);
+	glMatrixMode(GL_MODELVIEW);
+
+	gl_kawase_use(kb, shader, src, lw[src], lh[src]);
+	const GLfloat u = (GLfloat)lw[src] / gl_kawase_level_size(kb->width, src),
+	              v = (GLfloat)lh[src] / gl_kawase_level_size(kb->height, src);
+	glBegin(GL_QUADS);
+	glTexCoord2f(0, 0);
+	glVertex3f(0, 0, 0);
+	glTexCoord2f(u, 0);
+	glVertex3f(lw[dst], 0, 0);
+	glTexCoord2f(u, v);
+	glVertex3f(lw[dst], lh[dst], 0);
+	glTexCoord2f(0, v);
+	glVertex3f(0, lh[dst], 0);
+	glEnd();
+	return true;
+}
+
+/**
+ * Blur the area sized width x height starting at dx x dy with the dual-Kawase
+ * method, and paint the result to `reg_tgt` of the back buffer. The result is
+ * blended over the unblurred content with `opacity`, 1 replaces it entirely.
+ *
+ * Expects the projection set up by gl_resize() for a root_width x root_height
+ * screen, and leaves it that way.
+ */
+bool gl_kawase_blur_dst(struct gl_kawase_blur *kb, int root_width, int root_height,
+                        int dx, int dy, int width, int height, float z,
+                        GLfloat opacity, const region_t *reg_tgt) {
+	// We can only read back the part that is on screen
+	const int x1 = max_i(dx, 0), y1 = max_i(dy, 0);
+	const int x2 = min_i(dx + width, root_width), y2 = min_i(dy + height, root_height);
+	if (x1 >= x2 || y1 >= y2)
+		return true;
+
+	if (!gl_kawase_resize(kb, root_width, root_height))
+		return false;
+
+	const bool have_scissors = glIsEnabled(GL_SCISSOR_TEST);
+	const bool have_stencil = glIsEnabled(GL_STENCIL_TEST);
+	bool ret = false;
+
+	// Size of the valid content of each level
+	int lw[MAX_BLUR_ITERATIONS + 1], lh[MAX_BLUR_ITERATIONS + 1];
+	lw[0] = x2 - x1;
+	lh[0] = y2 - y1;
+	for (int i = 1; i <= kb->iterations; i++) {
+		lw[i] = max_i((lw[i - 1] + 1) / 2, 1);
+		lh[i] = max_i((lh[i - 1] + 1) / 2, 1);
+	}
+
+	// Read destination pixels into level 0. Like the framebuffer, its rows go
+	// bottom up.
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, kb->textures[0]);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x1, root_height - y2, lw[0], lh[0]);
+
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_SCISSOR_TEST);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glBindFramebuffer(GL_FRAMEBUFFER, kb->fbo);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+	bool passes_ok = true;
+	for (int i = 1; passes_ok && i <= kb->iterations; i++)
+		passes_ok = gl_kawase_pass(kb, &kb->down, i - 1, i, lw, lh);
+	// The last upsampling step goes straight to the screen
+	for (int i = kb->iterations - 1; passes_ok && i >= 1; i--)
+		passes_ok = gl_kawase_pass(kb, &kb->up, i + 1, i, lw, lh);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDrawBuffer(GL_BACK);
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glViewport(0, 0, root_width, root_height);
+	if (have_scissors)
+		glEnable(GL_SCISSOR_TEST);
+	if (have_stencil)
+		glEnable(GL_STENCIL_TEST);
+	if (!passes_ok)
+		goto end;
+
+	// Map screen coordinates to level 1 texture coordinates
+	gl_kawase_use(kb, &kb->up, 1, lw[1], lh[1]);
+	const GLfloat sx = (GLfloat)lw[1] / lw[0] / gl_kawase_level_size(kb->width, 1),
+	              sy = (GLfloat)lh[1] / lh[0] / gl_kawase_level_size(kb->height, 1);
+	if (opacity < 1) {
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+		glBlendColor(0, 0, 0, opacity);
+	}
+	P_PAINTREG_START(reg_tgt, crect) {
+		const GLfloat rx = (crect.x1 - x1) * sx;
+		const GLfloat ry = (y2 - crect.y1) * sy;
+		const GLfloat rxe = (crect.x2 - x1) * sx;
+		const GLfloat rye = (y2 - crect.y2) * sy;
+		const GLfloat rdx = crect.x1;
+		const GLfloat rdy = root_height - crect.y1;
+		const GLfloat rdxe = crect.x2;
+		const GLfloat rdye = root_height - crect.y2;
+
+		glTexCoord2f(rx, ry);
+		glVertex3f(rdx, rdy, z);
+
+		glTexCoord2f(rxe, ry);
+		glVertex3f(rdxe, rdy, z);
+
+		glTexCoord2f(rxe, rye);
+		glVertex3f(rdxe, rdye, z);
+
+		glTexCoord2f(rx, rye);
+		glVertex3f(rdx, rdye, z);
+	}
+	P_PAINTREG_END();
+	if (opacity < 1) {
+		glDisable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	ret = true;
+
+end:
+	glUseProgram(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	gl_check_err();
+
+	return ret;
+}
+
 /**
  * Set clipping region on the target window.
  */
@@ -713,16 +1404,10 @@ bool gl_create_blur_filters(session_t *ps, gl_blur_shader_t *passes, const gl_ca
 		auto pass = passes + i;
 		sprintf(pc, FRAG_SHADER_BLUR_SUFFIX, texture_func, sum);
 		assert(strlen(shader_str) < len);
-		pass->frag_shader = gl_create_shader(GL_FRAGMENT_SHADER, shader_str);
+		// Build program, the fragment shader isn't kept around
+		pass->frag_shader = 0;
+		pass->prog = gl_create_program_from_str(NULL, shader_str);
 		free(shader_str);
-
-		if (!pass->frag_shader) {
-			log_error("Failed to create fragment shader %d.", i);
-			goto err;
-		}
-
-		// Build program
-		pass->prog = gl_create_program(&pass->frag_shader, 1);
 		if (!pass->prog) {
 			log_error("Failed to create GLSL program.");
 			goto err;
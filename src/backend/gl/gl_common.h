@@ -69,9 +69,13 @@ typedef struct session session_t;
 	{ .prog = 0, .unifm_opacity = -1, .unifm_invert_color = -1, .unifm_tex = -1, }
 
 GLuint gl_create_shader(GLenum shader_type, const char *shader_str);
-GLuint gl_create_program(const GLuint *const shaders, int nshaders);
+GLuint gl_create_program(const GLuint *const shaders, int nshaders, bool retrievable);
 GLuint
 gl_create_program_from_str(const char *vert_shader_str, const char *frag_shader_str);
+
+void gl_program_cache_init(bool enabled);
+void gl_program_cache_deinit(void);
+void gl_program_cache_report(void);
 /**
  * @brief Render a region with texture data.
  */
@@ -87,6 +91,15 @@ unsigned char *gl_take_screenshot(session_t *ps, int *out_length);
 void gl_resize(int width, int height);
 bool gl_create_blur_filters(session_t *ps, gl_blur_shader_t *passes, const gl_cap_t *cap);
 
+struct gl_kawase_blur;
+struct gl_kawase_blur *gl_kawase_blur_new(int iterations, double strength);
+void gl_kawase_blur_free(struct gl_kawase_blur *);
+void gl_kawase_blur_release(struct gl_kawase_blur *);
+size_t gl_kawase_blur_texture_bytes(const struct gl_kawase_blur *);
+bool gl_kawase_blur_dst(struct gl_kawase_blur *, int root_width, int root_height,
+                        int dx, int dy, int width, int height, float z,
+                        GLfloat opacity, const region_t *reg_tgt);
+
 GLuint glGetUniformLocationChecked(GLuint p, const char *name);
 
 /**
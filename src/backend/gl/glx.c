@@ -42,6 +42,8 @@ struct _glx_data {
 	int glx_event;
 	int glx_error;
 	GLXContext ctx;
+	/// Whether the context has been unbound by glx_pause().
+	bool paused;
 	gl_cap_t cap;
 	gl_win_shader_t win_shader;
 	gl_blur_shader_t blur_shader[MAX_BLUR_PASS];
@@ -206,6 +208,10 @@ static inline void free_win_res_glx(session_t *ps, win *w) {
 static void glx_deinit(void *backend_data, session_t *ps) {
 	struct _glx_data *gd = backend_data;
 
+	// The resources below are freed through the context
+	if (gd->paused)
+		glXMakeCurrent(ps->dpy, get_tgt_window(ps), gd->ctx);
+
 	// Free all GLX resources of windows
 	for (win *w = ps->list; w; w = w->next)
 		free_win_res_glx(ps, w);
@@ -216,6 +222,7 @@ static void glx_deinit(void *backend_data, session_t *ps) {
 	}
 
 	gl_free_prog_main(ps, &gd->win_shader);
+	gl_program_cache_deinit();
 
 	gl_check_err();
 
@@ -354,8 +361,11 @@ static void *glx_init(session_t *ps) {
 	// glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	// glXSwapBuffers(ps->dpy, get_tgt_window(ps));
 
+	gl_program_cache_init(!ps->o.glx_no_program_cache);
+
 	// Initialize blur filters
 	// gl_create_blur_filters(ps, gd->blur_shader, &gd->cap);
+	gl_program_cache_report();
 
 	success = true;
 
@@ -371,6 +381,26 @@ end:
 	return gd;
 }
 
+static void glx_pause(void *backend_data, session_t *ps) {
+	struct _glx_data *gd = backend_data;
+	// Nothing is painted until resume. Unbinding the context allows the
+	// driver to free the buffers of the target window.
+	glFinish();
+	glXMakeCurrent(ps->dpy, None, NULL);
+	gd->paused = true;
+}
+
+static void glx_resume(void *backend_data, session_t *ps) {
+	struct _glx_data *gd = backend_data;
+	if (!gd->paused)
+		return;
+	if (!glXMakeCurrent(ps->dpy, get_tgt_window(ps), gd->ctx)) {
+		log_error("Failed to attach GLX context.");
+		return;
+	}
+	gd->paused = false;
+}
+
 static void *glx_prepare_win(void *backend_data, session_t *ps, win *w) {
 	struct _glx_data *gd = backend_data;
 	// Retrieve pixmap parameters, if they aren't provided
@@ -531,6 +561,8 @@ static void glx_compose(void *backend_data, session_t *ps, win *w, void *win_dat
 backend_info_t glx_backend = {
     .init = glx_init,
     .deinit = glx_deinit,
+    .pause = glx_pause,
+    .resume = glx_resume,
     .prepare_win = glx_prepare_win,
     .render_win = glx_render_win,
     .release_win = glx_release_win,
@@ -381,6 +381,18 @@ static void release_win(void *backend_data, session_t *ps, win *w, void *win_dat
 	free(wd);
 }
 
+static void create_back_buffer(struct _xrender_data *xd, session_t *ps) {
+	auto pictfmt = x_get_pictform_for_visual(ps->c, ps->vis);
+	if (!pictfmt) {
+		log_fatal("Default visual is invalid");
+		abort();
+	}
+
+	xd->back_pixmap =
+	    x_create_pixmap(ps->c, pictfmt->depth, ps->root, ps->root_width, ps->root_height);
+	xd->back = x_create_picture_with_pictfmt_and_pixmap(ps->c, pictfmt, xd->back_pixmap, 0, NULL);
+}
+
 static void *init(session_t *ps) {
 	auto xd = ccalloc(1, struct _xrender_data);
 
@@ -408,15 +420,7 @@ static void *init(session_t *ps) {
 		xd->target_win = ps->root;
 	}
 
-	auto pictfmt = x_get_pictform_for_visual(ps->c, ps->vis);
-	if (!pictfmt) {
-		log_fatal("Default visual is invalid");
-		abort();
-	}
-
-	xd->back_pixmap =
-	    x_create_pixmap(ps->c, pictfmt->depth, ps->root, ps->root_width, ps->root_height);
-	xd->back = x_create_picture_with_pictfmt_and_pixmap(ps->c, pictfmt, xd->back_pixmap, 0, NULL);
+	create_back_buffer(xd, ps);
 
 	xcb_pixmap_t root_pixmap = x_get_root_back_pixmap(ps);
 	if (root_pixmap == XCB_NONE) {
@@ -451,6 +455,21 @@ static void deinit(void *backend_data, session_t *ps) {
 	free(xd);
 }
 
+static void pause_backend(void *backend_data, session_t *ps) {
+	struct _xrender_data *xd = backend_data;
+	// The back buffer is screen-sized, and is not used until resume
+	xcb_render_free_picture(ps->c, xd->back);
+	xcb_free_pixmap(ps->c, xd->back_pixmap);
+	xd->back = XCB_NONE;
+	xd->back_pixmap = XCB_NONE;
+}
+
+static void resume_backend(void *backend_data, session_t *ps) {
+	struct _xrender_data *xd = backend_data;
+	if (!xd->back)
+		create_back_buffer(xd, ps);
+}
+
 static void *root_change(void *backend_data, session_t *ps) {
 	deinit(backend_data, ps);
 	return init(ps);
@@ -495,6 +514,8 @@ static void present(void *backend_data, session_t *ps) {
 struct backend_info xrender_backend = {
     .init = init,
     .deinit = deinit,
+    .pause = pause_backend,
+    .resume = resume_backend,
     .blur = blur,
     .present = present,
     .prepare = prepare,
@@ -40,6 +40,9 @@
 #include "log.h"
 #include "x.h"
 #include "compiler.h"
+#include "probe.h"
+#include "record.h"
+#include "roundtrip.h"
 
 #include "c2.h"
 
@@ -1462,8 +1465,10 @@ c2_match_once_leaf(session_t *ps, win *w, const c2_l_t *pleaf,
               idx, 1L, c2_get_atom_type(pleaf), pleaf->format);
           xcb_atom_t atom = winprop_get_int(prop);
           if (atom) {
-            xcb_get_atom_name_reply_t *reply =
-              xcb_get_atom_name_reply(ps->c, xcb_get_atom_name(ps->c, atom), NULL);
+            xcb_get_atom_name_reply_t *reply = record_reply(
+                RECORD_TAG_GET_ATOM_NAME,
+                X_ROUND_TRIP("get_atom_name", xcb_get_atom_name_reply(ps->c,
+                    xcb_get_atom_name(ps->c, atom), NULL)));
             if (reply) {
               tgt_free = strndup(
                   xcb_get_atom_name_name(reply), xcb_get_atom_name_name_length(reply));
@@ -1648,24 +1653,25 @@ c2_match(session_t *ps, win *w, const c2_lptr_t *condlst,
     const c2_lptr_t **cache, void **pdata) {
   assert(w->a.map_state == XCB_MAP_STATE_VIEWABLE);
 
+  PROBE(c2_match_begin, w->id, condlst);
+  const c2_lptr_t *matched = NULL;
+
   // Check if the cached entry matches firstly
-  if (cache && *cache && c2_match_once(ps, w, (*cache)->ptr)) {
-    if (pdata)
-      *pdata = (*cache)->data;
-    return true;
-  }
+  if (cache && *cache && c2_match_once(ps, w, (*cache)->ptr))
+    matched = *cache;
 
   // Then go through the whole linked list
-  for (; condlst; condlst = condlst->next) {
-    if (c2_match_once(ps, w, condlst->ptr)) {
-      if (cache)
-        *cache = condlst;
-      if (pdata)
-        *pdata = condlst->data;
-      return true;
-    }
-  }
+  for (const c2_lptr_t *i = condlst; i && !matched; i = i->next)
+    if (c2_match_once(ps, w, i->ptr))
+      matched = i;
 
-  return false;
+  if (matched) {
+    if (cache)
+      *cache = matched;
+    if (pdata)
+      *pdata = matched->data;
+  }
+  PROBE(c2_match_end, w->id, condlst, matched != NULL);
+  return matched != NULL;
 }
 
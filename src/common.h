@@ -82,6 +82,7 @@
 #include "types.h"
 #include "win.h"
 #include "region.h"
+#include "damage.h"
 #include "kernel.h"
 #include "render.h"
 #include "config.h"
@@ -102,12 +103,9 @@
 #define REGISTER_PROP "_NET_WM_CM_S"
 
 #define TIME_MS_MAX LONG_MAX
-#define FADE_DELTA_TOLERANCE 0.2
 #define SWOPTI_TOLERANCE 3000
 #define WIN_GET_LEADER_MAX_RECURSION 20
 
-#define SEC_WRAP (15L * 24L * 60L * 60L)
-
 #define NS_PER_SEC 1000000000L
 #define US_PER_SEC 1000000L
 #define MS_PER_SEC 1000
@@ -251,6 +249,20 @@ struct glx_prog_main { };
 
 #define PAINT_INIT { .pixmap = XCB_NONE, .pict = XCB_NONE }
 
+/// Number of back buffers used with --vsync present.
+#define PRESENT_NBUFFERS 3
+
+/// A back buffer used with --vsync present.
+typedef struct {
+  paint_t paint;
+  /// Size of the buffer, to detect screen size changes.
+  int width, height;
+  /// Whether the X server holds the buffer since we presented it.
+  bool busy;
+  /// The frame last presented from this buffer, 0 if none.
+  unsigned long frame;
+} present_buffer_t;
+
 /// Linked list type of atoms.
 typedef struct _latom {
   xcb_atom_t atom;
@@ -281,8 +293,14 @@ typedef struct {
   f_ImportSyncEXT glImportSyncEXT;
   /// Current GLX Z value.
   int z;
+  /// Depths whose pixmaps don't need to be rebound to show new content, as a
+  /// bit mask. Only set if the probe at initialization passed for every depth
+  /// it tried.
+  uint64_t tfp_live_depths;
 #ifdef CONFIG_OPENGL
   glx_blur_pass_t blur_passes[MAX_BLUR_PASS];
+  /// State of the dual-Kawase blur, if that method is in use.
+  struct gl_kawase_blur *kawase_blur;
 #endif
 } glx_session_t;
 
@@ -299,6 +317,12 @@ typedef struct session {
   ev_timer unredir_timer;
   /// Timer for fading
   ev_timer fade_timer;
+  /// Timer for painting the repaint heat map as it cools down.
+  ev_timer heatmap_timer;
+  /// Timer for repairing windows held back by damage rate rules.
+  ev_timer damage_rate_timer;
+  /// Timer for freeing painting resources when there is no damage.
+  ev_timer release_timer;
   /// Timer for delayed drawing, right now only used by
   /// swopti
   ev_timer delayed_draw_timer;
@@ -309,8 +333,13 @@ typedef struct session {
   /// so we can be sure if xcb read from X socket at anytime during event
   /// handling, we will not left any event unhandled in the queue
   ev_prepare event_check;
+  /// Keeps the main loop from sleeping while X events are left for the next
+  /// iteration, with <code>--event-budget</code>.
+  ev_idle event_idle;
   /// Signal handler for SIGUSR1
   ev_signal usr1_signal;
+  /// Signal handler for SIGUSR2, which turns tracing on and off
+  ev_signal usr2_signal;
   /// Signal handler for SIGINT
   ev_signal int_signal;
   /// backend data
@@ -376,18 +405,16 @@ typedef struct session {
   bool fade_running;
   /// Program start time.
   struct timeval time_start;
-  /// The region needs to painted on next paint.
-  region_t *damage;
-  /// The region damaged on the last paint.
-  region_t *damage_ring;
-  /// Number of damage regions we track
-  int ndamage;
+  /// Damage of the frame to be painted, and of recent frames.
+  struct damage_history damage;
   /// Whether all windows are currently redirected.
   bool redirected;
   /// Pre-generated alpha pictures.
   xcb_render_picture_t *alpha_picts;
-  /// Time of last fading. In milliseconds.
-  unsigned long fade_time;
+  /// When the frame after the current one should be painted for fading
+  /// windows to change their alpha, in microseconds on the clock of
+  /// pacing_now(). 0 if nothing is fading.
+  long fade_next;
   /// Head pointer of the error ignore linked list.
   ignore_t *ignore_head;
   /// Pointer to the <code>next</code> member of tail element of the error
@@ -412,6 +439,15 @@ typedef struct session {
   // === Window related ===
   /// Linked list of all windows.
   win *list;
+  /// Windows whose fading, flags or painting state may have changed since
+  /// the last paint, linked by <code>next_changed</code>.
+  win *changed_list;
+  /// Whether the next paint has to look at all windows, after a change not
+  /// tied to a single window.
+  bool preprocess_all;
+  /// Highest window painted in the last paint, the start of the
+  /// <code>prev_trans</code> chain.
+  win *paint_top;
   /// Pointer to <code>win</code> of current active window. Used by
   /// EWMH <code>_NET_ACTIVE_WINDOW</code> focus detection. In theory,
   /// it's more reliable to store the window ID directly here, just in
@@ -442,12 +478,69 @@ typedef struct session {
   long refresh_intv;
   /// Nanosecond offset of the first painting.
   long paint_tm_offset;
+  /// Frame scheduler state, if --frame-pacing is enabled.
+  struct frame_pacing *pacing;
+  /// Damage-to-photon latency of recent frames.
+  struct latency_stats *latency;
+  /// Time spent in each stage of recent frames.
+  struct frame_timing *timing;
+  /// Heat map of client damage, if --monitor-repaint is enabled.
+  struct heatmap *heatmap;
+  /// Trace writer, if tracing is on.
+  struct tracer *trace;
+
+  // === Event processing ===
+  /// DamageNotify and PropertyNotify events put off until structural events
+  /// are handled, with <code>--event-budget</code>.
+  xcb_generic_event_t **deferred_events;
+  /// Number of events in <code>deferred_events</code>.
+  int ndeferred_events;
+  /// Allocated size of <code>deferred_events</code>.
+  int deferred_events_cap;
+  /// Largest number of events left for a later loop iteration.
+  int event_backlog_max;
+  /// Number of X events handled.
+  unsigned long events_handled;
+  /// Number of events put off behind structural events.
+  unsigned long events_deferred;
+  /// Number of put off events dropped, as an equivalent one was waiting.
+  unsigned long events_coalesced;
+  /// Number of loop iterations that ran out of time with events left.
+  unsigned long event_budget_overruns;
+
+  // === Resource release ===
+  /// Number of times painting resources have been freed.
+  unsigned long releases;
+  /// Estimated size of painting resources before the last release, in bytes.
+  size_t release_before;
+  /// Estimated size of painting resources after the last release, in bytes.
+  size_t release_after;
+  /// Number of times painting resources have been freed to stay within
+  /// --resource-budget.
+  unsigned long evictions;
+  /// Estimated size of painting resources freed to stay within the budget,
+  /// in bytes.
+  size_t evicted;
+  /// When the budget was last checked.
+  long budget_checked;
 
 #ifdef CONFIG_VSYNC_DRM
   // === DRM VSync related ===
   /// File descriptor of DRI device file. Used for DRM VSync.
   int drm_fd;
+  /// Watcher of drm_fd for vblank events, used by --vsync drm-event.
+  ev_io drm_io;
+#endif
+#ifdef CONFIG_OPENGL
+  /// Thread waiting for vblanks for --vsync opengl and opengl-oml.
+  struct vsync_thread *vsync_thread;
+  /// Watcher of the eventfd signalled by vsync_thread.
+  ev_io vsync_thread_io;
 #endif
+  /// Whether a painted frame waits for a vblank event to be shown.
+  bool vblank_pending;
+  /// Part of the waiting frame that has been updated.
+  region_t vblank_commit_region;
 
   // === X extension related ===
   /// Event base number for X Fixes extension.
@@ -485,6 +578,20 @@ typedef struct session {
   int randr_error;
   /// Whether X Present extension exists.
   bool present_exists;
+  /// Major opcode of X Present extension.
+  uint8_t present_opcode;
+  /// Present event context selected on the target window, if any.
+  uint32_t present_eid;
+  /// Back buffers of --vsync present.
+  present_buffer_t present_bufs[PRESENT_NBUFFERS];
+  /// Index of the back buffer being painted to, -1 if none.
+  int present_cur;
+  /// Number of frames presented so far.
+  unsigned long present_frame;
+  /// Whether the last presented frame has not been completed yet.
+  bool present_pending;
+  /// MSC of the last completed presentation.
+  uint64_t present_msc;
 #ifdef CONFIG_OPENGL
   /// Whether X GLX extension exists.
   bool glx_exists;
@@ -574,6 +681,9 @@ print_timestamp(session_t *ps);
 void
 ev_xcb_error(session_t *ps, xcb_generic_error_t *err);
 
+const char *
+ev_type_name(session_t *ps, int type);
+
 // === Functions ===
 
 /**
@@ -952,6 +1062,12 @@ winprop_get_int(winprop_t prop) {
 void
 force_repaint(session_t *ps);
 
+bool
+set_tracing(session_t *ps, bool enable);
+
+void
+resume_redraw(session_t *ps);
+
 bool
 vsync_init(session_t *ps);
 
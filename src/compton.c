@@ -13,6 +13,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
+#include <math.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xlib-xcb.h>
@@ -49,6 +50,16 @@
 #include "dbus.h"
 #endif
 #include "options.h"
+#include "heatmap.h"
+#include "latency.h"
+#include "pacing.h"
+#include "present.h"
+#include "probe.h"
+#include "record.h"
+#include "roundtrip.h"
+#include "timing.h"
+#include "trace.h"
+#include "vsync.h"
 
 #define CASESTRRET(s)   case s: return #s
 
@@ -131,6 +142,8 @@ const char * const VSYNC_STRS[NUM_VSYNC + 1] = {
   "opengl-oml",       // VSYNC_OPENGL_OML
   "opengl-swc",       // VSYNC_OPENGL_SWC
   "opengl-mswc",      // VSYNC_OPENGL_MSWC
+  "present",          // VSYNC_PRESENT
+  "drm-event",        // VSYNC_DRM_EVENT
   NULL
 };
 
@@ -142,6 +155,22 @@ const char * const BACKEND_STRS[NUM_BKEND + 1] = {
   NULL
 };
 
+/// Names of blur methods.
+const char * const BLUR_METHOD_STRS[NUM_BLUR_METHOD + 1] = {
+  "kernel",       // BLUR_METHOD_KERNEL
+  "dual_kawase",  // BLUR_METHOD_DUAL_KAWASE
+  NULL
+};
+
+/// Names of fade easing curves.
+const char * const FADE_EASING_STRS[NUM_FADE_EASING + 1] = {
+  "linear",       // FADE_EASING_LINEAR
+  "ease-in",      // FADE_EASING_IN
+  "ease-out",     // FADE_EASING_OUT
+  "ease-in-out",  // FADE_EASING_IN_OUT
+  NULL
+};
+
 // === Global variables ===
 
 /// Pointer to current session, as a global variable. Only used by
@@ -187,18 +216,6 @@ free_win_res(session_t *ps, win *w) {
   free(w->role);
 }
 
-/**
- * Get current system clock in milliseconds.
- */
-static inline unsigned long
-get_time_ms(void) {
-  struct timeval tv;
-
-  gettimeofday(&tv, NULL);
-
-  return tv.tv_sec % SEC_WRAP * 1000 + tv.tv_usec / 1000;
-}
-
 /**
  * Get the Xinerama screen a window is on.
  *
@@ -237,17 +254,18 @@ cxinerama_upd_scrs(session_t *ps) {
 
   if (!ps->o.xinerama_shadow_crop || !ps->xinerama_exists) return;
 
-  xcb_xinerama_is_active_reply_t *active =
+  xcb_xinerama_is_active_reply_t *active = X_ROUND_TRIP("xinerama_is_active",
     xcb_xinerama_is_active_reply(ps->c,
-        xcb_xinerama_is_active(ps->c), NULL);
+        xcb_xinerama_is_active(ps->c), NULL));
   if (!active || !active->state) {
     free(active);
     return;
   }
   free(active);
 
-  ps->xinerama_scrs = xcb_xinerama_query_screens_reply(ps->c,
-      xcb_xinerama_query_screens(ps->c), NULL);
+  ps->xinerama_scrs = X_ROUND_TRIP("xinerama_query_screens",
+      xcb_xinerama_query_screens_reply(ps->c,
+        xcb_xinerama_query_screens(ps->c), NULL));
   if (!ps->xinerama_scrs)
     return;
 
@@ -304,60 +322,134 @@ void add_damage(session_t *ps, const region_t *damage) {
   if (!ps->redirected)
     return;
 
+  // Restart the countdown to freeing painting resources
+  if (ps->o.release_resources_delay) {
+    ps->release_timer.repeat = ps->o.release_resources_delay / 1000.0;
+    ev_timer_again(ps->loop, &ps->release_timer);
+  }
+
   if (!damage)
     return;
-  pixman_region32_union(ps->damage, ps->damage, (region_t *)damage);
+  damage_history_add(&ps->damage, damage);
 }
 
 // === Fading ===
 
 /**
- * Get the time left before next fading point.
+ * Get the time left before the next fading window changes its alpha.
  *
- * In milliseconds.
+ * In seconds.
  */
 static double
 fade_timeout(session_t *ps) {
-  auto now = get_time_ms();
-  if (ps->o.fade_delta + ps->fade_time < now)
-    return 0;
+  // Don't wake up more often than once every fade_delta
+  long diff = max_l(ps->fade_next - pacing_now(), ps->o.fade_delta * 1000L);
+  return diff / 1e6;
+}
+
+/**
+ * Map the elapsed fraction of a fade to the fraction of the opacity change
+ * that is done.
+ */
+static double
+fade_ease(enum fade_easing easing, double t) {
+  switch (easing) {
+    case FADE_EASING_IN:
+      return t * t * t;
+    case FADE_EASING_OUT:
+      return 1 - pow(1 - t, 3);
+    case FADE_EASING_IN_OUT:
+      return t < 0.5 ? 4 * t * t * t : 1 - pow(2 - 2 * t, 3) / 2;
+    default:
+      return t;
+  }
+}
 
-  int diff = ps->o.fade_delta + ps->fade_time - now;
+/**
+ * Get the opacity of a fading window at a point of time.
+ *
+ * The result is rounded to one of the MAX_ALPHA + 1 levels windows are painted
+ * with, so the opacity only changes when the painted window does.
+ *
+ * @param when time in microseconds, on the clock of pacing_now()
+ */
+static opacity_t
+fade_opacity_at(session_t *ps, const win *w, long when) {
+  if (when >= w->fade_start + w->fade_duration)
+    return w->fade_to;
 
-  diff = normalize_i_range(diff, 0, ps->o.fade_delta * 2);
+  double t = (double) max_l(when - w->fade_start, 0) / w->fade_duration;
+  double o = w->fade_from +
+    ((double) w->fade_to - (double) w->fade_from) * fade_ease(ps->o.fade_easing, t);
+  o = lround(o / OPAQUE * MAX_ALPHA) * (double) (OPAQUE / MAX_ALPHA);
 
-  return diff / 1000.0;
+  // Don't overshoot the target because of rounding
+  if (w->fade_from < w->fade_to)
+    return normalize_d_range(o, w->fade_from, w->fade_to);
+  return normalize_d_range(o, w->fade_to, w->fade_from);
+}
+
+/**
+ * Find when a fading window next changes its opacity, after `when`.
+ */
+static long
+fade_next_change(session_t *ps, const win *w, long when) {
+  // Easing curves are monotonic, so the first change can be bisected
+  long lo = when, hi = w->fade_start + w->fade_duration;
+  while (hi - lo > 100) {
+    long mid = lo + (hi - lo) / 2;
+    if (fade_opacity_at(ps, w, mid) == w->opacity)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return hi;
 }
 
 /**
  * Run fading on a window.
  *
- * @param steps steps of fading
+ * A fade starts when the target opacity changes, and takes as long as the
+ * opacity change would take with fade_in_step/fade_out_step every fade_delta.
+ *
+ * @param now current time, in microseconds
+ * @param when when the frame being painted is expected to be shown
  */
 static void
-run_fade(session_t *ps, win *w, unsigned steps) {
+run_fade(session_t *ps, win *w, long now, long when) {
   // If we have reached target opacity, return
   if (w->opacity == w->opacity_tgt) {
+    w->fade_duration = 0;
     return;
   }
 
-  if (!w->fade)
+  if (!w->fade) {
     w->opacity = w->opacity_tgt;
-  else if (steps) {
+    w->fade_duration = 0;
+    return;
+  }
+
+  // Start a new fade if the target changed
+  if (!w->fade_duration || w->fade_to != w->opacity_tgt) {
     // Use double below because opacity_t will probably overflow during
     // calculations
-    if (w->opacity < w->opacity_tgt)
-      w->opacity = normalize_d_range(
-          (double) w->opacity + (double) ps->o.fade_in_step * steps,
-          0.0, w->opacity_tgt);
-    else
-      w->opacity = normalize_d_range(
-          (double) w->opacity - (double) ps->o.fade_out_step * steps,
-          w->opacity_tgt, OPAQUE);
+    opacity_t step = w->opacity < w->opacity_tgt ?
+      ps->o.fade_in_step : ps->o.fade_out_step;
+    double dist = fabs((double) w->opacity_tgt - (double) w->opacity);
+    w->fade_from = w->opacity;
+    w->fade_to = w->opacity_tgt;
+    w->fade_start = now;
+    w->fade_duration = max_l(dist / max_l(step, 1) * ps->o.fade_delta * 1000, 1);
   }
 
+  w->opacity = fade_opacity_at(ps, w, when);
+
   if (w->opacity != w->opacity_tgt) {
     ps->fade_running = true;
+    // Paint the next change as early before it as this frame
+    long next = fade_next_change(ps, w, when) - (when - now);
+    if (!ps->fade_next || next < ps->fade_next)
+      ps->fade_next = next;
   }
 }
 
@@ -432,7 +524,8 @@ win *find_toplevel2(session_t *ps, xcb_window_t wid) {
     // xcb_query_tree probably fails if you run compton when X is somehow
     // initializing (like add it in .xinitrc). In this case
     // just leave it alone.
-    reply = xcb_query_tree_reply(ps->c, xcb_query_tree(ps->c, wid), NULL);
+    reply = record_reply(RECORD_TAG_QUERY_TREE, X_ROUND_TRIP("query_tree",
+        xcb_query_tree_reply(ps->c, xcb_query_tree(ps->c, wid), NULL)));
     if (reply == NULL) {
       break;
     }
@@ -463,8 +556,9 @@ recheck_focus(session_t *ps) {
   // Determine the currently focused window so we can apply appropriate
   // opacity on it
   xcb_window_t wid = XCB_NONE;
-  xcb_get_input_focus_reply_t *reply =
-    xcb_get_input_focus_reply(ps->c, xcb_get_input_focus(ps->c), NULL);
+  xcb_get_input_focus_reply_t *reply = record_reply(RECORD_TAG_GET_INPUT_FOCUS,
+    X_ROUND_TRIP("get_input_focus",
+      xcb_get_input_focus_reply(ps->c, xcb_get_input_focus(ps->c), NULL)));
 
   if (reply) {
     wid = reply->focus;
@@ -494,8 +588,9 @@ find_client_win(session_t *ps, xcb_window_t w) {
     return w;
   }
 
-  xcb_query_tree_reply_t *reply = xcb_query_tree_reply(ps->c,
-      xcb_query_tree(ps->c, w), NULL);
+  xcb_query_tree_reply_t *reply = record_reply(RECORD_TAG_QUERY_TREE,
+      X_ROUND_TRIP("query_tree",
+        xcb_query_tree_reply(ps->c, xcb_query_tree(ps->c, w), NULL)));
   if (!reply)
     return 0;
 
@@ -518,22 +613,32 @@ static win *
 paint_preprocess(session_t *ps, win *list) {
   win *t = NULL, *next = NULL;
 
-  // Fading step calculation
-  unsigned long steps = 0L;
-  auto now = get_time_ms();
-  auto tolerance = FADE_DELTA_TOLERANCE*ps->o.fade_delta;
-  if (ps->fade_time && now+tolerance >= ps->fade_time) {
-    steps = (now - ps->fade_time + tolerance) / ps->o.fade_delta;
-  } else {
-    // Reset fade_time if unset, or there appears to be a time disorder
-    ps->fade_time = get_time_ms();
-    steps = 0L;
-  }
-  ps->fade_time += steps * ps->o.fade_delta;
+  // Fading is sampled at the time the frame is expected to be shown
+  long now = pacing_now();
+  long when = now;
+  if (ps->pacing && ps->pacing->target_vblank > now)
+    when = ps->pacing->target_vblank;
+
+  // Only windows that changed since the last paint are looked at. Windows
+  // still fading are put back into the set below.
+  const bool all = ps->preprocess_all;
+  ps->preprocess_all = false;
+  if (all)
+    for (win *w = list; w; w = w->next)
+      win_mark_changed(ps, w);
+  win *changed = ps->changed_list;
+  ps->changed_list = NULL;
+
+  // Nothing that decides what to paint has changed, the windows to paint and
+  // their reg_ignore are the same as in the last paint
+  if (!changed && !all)
+    return ps->paint_top;
 
   // First, let's process fading
-  for (win *w = list; w; w = next) {
-    next = w->next;
+  for (win *w = changed; w; w = next) {
+    next = w->next_changed;
+    w->changed = false;
+    w->next_changed = NULL;
     const winmode_t mode_old = w->mode;
     const bool was_painted = w->to_paint;
     const opacity_t opacity_old = w->opacity;
@@ -552,7 +657,7 @@ paint_preprocess(session_t *ps, win *list) {
     }
 
     // Run fading
-    run_fade(ps, w, steps);
+    run_fade(ps, w, now, when);
 
     if (win_has_frame(w))
       w->frame_opacity = ps->o.frame_opacity;
@@ -679,6 +784,10 @@ paint_preprocess(session_t *ps, win *list) {
     if (w) {
       w->to_paint = to_paint;
 
+      // Keep running the fade in the next paint
+      if (w->opacity != w->opacity_tgt)
+        win_mark_changed(ps, w);
+
       if (w->to_paint) {
         // Save flags
         w->shadow_last = w->shadow;
@@ -713,6 +822,7 @@ paint_preprocess(session_t *ps, win *list) {
     redir_start(ps);
   }
 
+  ps->paint_top = t;
   return t;
 }
 
@@ -773,12 +883,15 @@ repair_win(session_t *ps, win *w) {
     xcb_xfixes_destroy_region(ps->c, tmp);
   }
 
+  if (!w->ever_damaged)
+    win_mark_changed(ps, w);
   w->ever_damaged = true;
   w->pixmap_damaged = true;
 
   // Why care about damage when screen is unredirected?
   // We will force full-screen repaint on redirection.
   if (!ps->redirected) {
+    w->damage_time = 0;
     pixman_region32_fini(&parts);
     return;
   }
@@ -788,9 +901,31 @@ repair_win(session_t *ps, win *w) {
     pixman_region32_subtract(&parts, &parts, w->reg_ignore);
 
   add_damage(ps, &parts);
+  if (ps->heatmap)
+    heatmap_damage(ps->heatmap, &parts);
+  // Measure latency from when the client damage came in
+  damage_history_stamp(&ps->damage, w->damage_time);
+  w->damage_time = 0;
   pixman_region32_fini(&parts);
 }
 
+/**
+ * Arm the damage rate timer for the first window whose damage is held back.
+ */
+static void
+schedule_held_damage(session_t *ps, long now) {
+  long next = 0;
+  for (win *w = ps->list; w; w = w->next)
+    if (w->damage_held && (!next || w->damage_next < next))
+      next = w->damage_next;
+
+  ev_timer_stop(ps->loop, &ps->damage_rate_timer);
+  if (next) {
+    ev_timer_set(&ps->damage_rate_timer, max_l(next - now, 0) / 1e6, 0);
+    ev_timer_start(ps->loop, &ps->damage_rate_timer);
+  }
+}
+
 static void
 finish_map_win(session_t *ps, win **_w) {
   win *w = *_w;
@@ -802,10 +937,13 @@ finish_map_win(session_t *ps, win **_w) {
 
 void
 map_win(session_t *ps, xcb_window_t id) {
+  PROBE(map_win, id);
+
   // Unmap overlay window if it got mapped but we are currently not
   // in redirected state.
   if (ps->overlay && id == ps->overlay && !ps->redirected) {
-    auto e = xcb_request_check(ps->c, xcb_unmap_window(ps->c, ps->overlay));
+    auto e = X_ROUND_TRIP("unmap_window",
+        xcb_request_check(ps->c, xcb_unmap_window(ps->c, ps->overlay)));
     if (e) {
       log_error("Failed to unmap the overlay window");
       free(e);
@@ -870,6 +1008,7 @@ map_win(session_t *ps, xcb_window_t id) {
   // Update opacity and dim state
   win_update_opacity_prop(ps, w);
   w->flags |= WFLAG_OPCT_CHANGE;
+  win_mark_changed(ps, w);
 
   // Check for _COMPTON_SHADOW
   if (ps->o.respect_prop_shadow)
@@ -913,6 +1052,7 @@ finish_unmap_win(session_t *ps, win **_w) {
   w->ever_damaged = false;
   w->in_openclose = false;
   w->reg_ignore_valid = false;
+  win_mark_changed(ps, w);
 
   /* damage region */
   add_damage_from_win(ps, w);
@@ -933,8 +1073,18 @@ unmap_win(session_t *ps, win **_w) {
 
   w->a.map_state = XCB_MAP_STATE_UNMAPPED;
 
+  // repair_win() skips unmapped windows, so damage held back by the rate
+  // limit has to be subtracted here. Otherwise the X server never reports
+  // damage again, and the window isn't painted after it is mapped.
+  if (w->damage_held) {
+    w->damage_held = false;
+    set_ignore_cookie(ps,
+        xcb_damage_subtract(ps->c, w->damage, XCB_NONE, XCB_NONE));
+  }
+
   // Fading out
   w->flags |= WFLAG_OPCT_CHANGE;
+  win_mark_changed(ps, w);
   win_set_fade_callback(ps, _w, finish_unmap_win, false);
   w->in_openclose = true;
   win_determine_fade(ps, w);
@@ -967,9 +1117,11 @@ restack_win(session_t *ps, win *w, xcb_window_t new_above) {
   if (old_above != new_above) {
     w->reg_ignore_valid = false;
     rc_region_unref(&w->reg_ignore);
+    win_mark_changed(ps, w);
     if (w->next) {
       w->next->reg_ignore_valid = false;
       rc_region_unref(&w->next->reg_ignore);
+      win_mark_changed(ps, w->next);
     }
 
     win **prev = NULL, **prev_old = NULL;
@@ -1040,17 +1192,20 @@ static void
 configure_win(session_t *ps, xcb_configure_notify_event_t *ce) {
   // On root window changes
   if (ce->window == ps->root) {
-    free_paint(ps, &ps->tgt_buffer);
+    // A frame waiting for a vblank would be shown from the freed buffer
+    vsync_drop_frame(ps);
+    // With Present the target buffer is one of its back buffers
+    if (ps->o.vsync == VSYNC_PRESENT)
+      present_drop_buffers(ps);
+    else
+      free_paint(ps, &ps->tgt_buffer);
 
     ps->root_width = ce->width;
     ps->root_height = ce->height;
 
     rebuild_screen_reg(ps);
     rebuild_shadow_exclude_reg(ps);
-    for (int i = 0; i < ps->ndamage; i++) {
-	    pixman_region32_clear(&ps->damage_ring[i]);
-    }
-    ps->damage = ps->damage_ring + ps->ndamage - 1;
+    damage_history_reset(&ps->damage);
 
     // Re-redirect screen if required
     if (ps->o.reredir_on_root_change && ps->redirected) {
@@ -1061,6 +1216,7 @@ configure_win(session_t *ps, xcb_configure_notify_event_t *ce) {
     // Invalidate reg_ignore from the top
     rc_region_unref(&ps->list->reg_ignore);
     ps->list->reg_ignore_valid = false;
+    ps->preprocess_all = true;
 
 #ifdef CONFIG_OPENGL
     // Reinitialize GLX on root change
@@ -1184,6 +1340,10 @@ finish_destroy_win(session_t *ps, win **_w) {
       for (win *w2 = ps->list; w2; w2 = w2->next)
         if (w == w2->prev_trans)
           w2->prev_trans = NULL;
+      win_unmark_changed(ps, w);
+      if (w == ps->paint_top)
+        ps->paint_top = NULL;
+      ps->preprocess_all = true;
 
       free(w);
       *_w = NULL;
@@ -1254,6 +1414,16 @@ expose_root(session_t *ps, const rect_t *rects, int nrects) {
   pixman_region32_init_rects(&region, rects, nrects);
   add_damage(ps, &region);
 }
+/**
+ * Restart drawing that was held back until the previous frame is shown.
+ */
+void
+resume_redraw(session_t *ps) {
+  if (ps->redraw_needed && vsync_can_paint(ps)
+      && !ev_is_active(&ps->draw_idle) && !ev_is_active(&ps->delayed_draw_timer))
+    ev_idle_start(ps->loop, &ps->draw_idle);
+}
+
 /**
  * Force a full-screen repaint.
  */
@@ -1264,6 +1434,28 @@ force_repaint(session_t *ps) {
   add_damage(ps, &ps->screen_reg);
 }
 
+/**
+ * Turn tracing on or off.
+ *
+ * Each time tracing is turned on, the trace file is written anew.
+ */
+bool
+set_tracing(session_t *ps, bool enable) {
+  if (!enable) {
+    trace_stop(ps->trace);
+    ps->trace = NULL;
+    return true;
+  }
+  if (ps->trace)
+    return true;
+  if (!ps->o.trace_file) {
+    log_error("Tracing needs a file to write to, set one with --trace-file.");
+    return false;
+  }
+  ps->trace = trace_start(ps->o.trace_file);
+  return ps->trace;
+}
+
 #ifdef CONFIG_DBUS
 /** @name DBus hooks
  */
@@ -1398,6 +1590,15 @@ ev_name(session_t *ps, xcb_generic_event_t *ev) {
   return buf;
 }
 
+/**
+ * Name of an X event type, only valid until the next call.
+ */
+const char *
+ev_type_name(session_t *ps, int type) {
+  xcb_generic_event_t ev = { .response_type = (uint8_t)type };
+  return ev_name(ps, &ev);
+}
+
 static inline xcb_window_t attr_unused
 ev_window(session_t *ps, xcb_generic_event_t *ev) {
   switch (ev->response_type) {
@@ -1625,8 +1826,8 @@ ev_property_notify(session_t *ps, xcb_property_notify_event_t *ev) {
 #ifdef DEBUG_EVENTS
   {
     // Print out changed atom
-    xcb_get_atom_name_reply_t *reply =
-      xcb_get_atom_name_reply(ps->c, xcb_get_atom_name(ps->c, ev->atom), NULL);
+    xcb_get_atom_name_reply_t *reply = X_ROUND_TRIP("get_atom_name",
+      xcb_get_atom_name_reply(ps->c, xcb_get_atom_name(ps->c, ev->atom), NULL));
     const char *name = "?";
     int name_len = 1;
     if (reply) {
@@ -1687,6 +1888,7 @@ ev_property_notify(session_t *ps, xcb_property_notify_event_t *ev) {
     if (w) {
       win_update_opacity_prop(ps, w);
       w->flags |= WFLAG_OPCT_CHANGE;
+      win_mark_changed(ps, w);
     }
   }
 
@@ -1767,6 +1969,25 @@ ev_damage_notify(session_t *ps, xcb_damage_notify_event_t *de) {
 
   if (!w) return;
 
+  long now = pacing_now();
+  win_count_damage(ps, w, now);
+  if (!w->damage_time)
+    w->damage_time = now;
+
+  // Rate limited windows are repaired on their own schedule. Their damage
+  // accumulates in the X server meanwhile, which sends no more DamageNotify
+  // until it is subtracted.
+  if (w->damage_rate_limit) {
+    if (now < w->damage_next) {
+      if (!w->damage_held) {
+        w->damage_held = true;
+        schedule_held_damage(ps, now);
+      }
+      return;
+    }
+    w->damage_next = now + US_PER_SEC / w->damage_rate_limit;
+  }
+
   repair_win(ps, w);
 }
 
@@ -1794,6 +2015,7 @@ ev_shape_notify(session_t *ps, xcb_shape_notify_event_t *ev) {
   pixman_region32_fini(&tmp);
 
   w->reg_ignore_valid = false;
+  win_mark_changed(ps, w);
 }
 
 /**
@@ -1811,6 +2033,8 @@ ev_screen_change_notify(session_t *ps,
       log_warn("Refresh rate detection failed. swopti will be temporarily disabled");
     }
   }
+  else if (!ps->o.refresh_rate)
+    update_refresh_rate(ps);
 }
 
 inline static void
@@ -1851,10 +2075,20 @@ ev_window_name(session_t *ps, xcb_window_t wid, char **name) {
 
 static void
 ev_handle(session_t *ps, xcb_generic_event_t *ev) {
+  record_event(ev);
+
   if ((ev->response_type & 0x7f) != KeymapNotify) {
     discard_ignore(ps, ev->full_sequence);
   }
 
+  // Present events only pace our own frames, they never need a redraw
+  if (present_handle_event(ps, ev))
+    return;
+
+  long span = trace_begin(ps->trace);
+  round_trip_event_begin(ev->response_type);
+  PROBE(event_begin, ev->response_type, ev_window(ps, ev));
+
 #ifdef DEBUG_EVENTS
   if (ev->response_type != ps->damage_event + XCB_DAMAGE_NOTIFY) {
     xcb_window_t wid = ev_window(ps, ev);
@@ -1890,6 +2124,8 @@ ev_handle(session_t *ps, xcb_generic_event_t *ev) {
     proc(ps->dpy, &dummy, (xEvent *)ev);
   }
 
+  ps->events_handled++;
+
   // XXX redraw needs to be more fine grained
   queue_redraw(ps);
 
@@ -1947,6 +2183,14 @@ ev_handle(session_t *ps, xcb_generic_event_t *ev) {
         break;
       }
   }
+
+  // Only ask for the name and window when tracing, ev_name() formats unknown
+  // events into a buffer, which the trace copies
+  if (span)
+    trace_end(ps->trace, span, "ev_handle", "event", ev_name(ps, ev),
+        ev_window(ps, ev));
+  round_trip_end();
+  PROBE(event_end, ev->response_type);
 }
 
 // === Main ===
@@ -2103,8 +2347,8 @@ init_atoms(session_t *ps) {
 static void
 update_refresh_rate(session_t *ps) {
   xcb_randr_get_screen_info_reply_t *randr_info =
-    xcb_randr_get_screen_info_reply(ps->c,
-        xcb_randr_get_screen_info(ps->c, ps->root), NULL);
+    X_ROUND_TRIP("randr_get_screen_info", xcb_randr_get_screen_info_reply(ps->c,
+        xcb_randr_get_screen_info(ps->c, ps->root), NULL));
 
   if (!randr_info)
     return;
@@ -2115,6 +2359,9 @@ update_refresh_rate(session_t *ps) {
     ps->refresh_intv = US_PER_SEC / ps->refresh_rate;
   else
     ps->refresh_intv = 0;
+
+  if (ps->pacing)
+    pacing_set_refresh_interval(ps->pacing, ps->refresh_intv);
 }
 
 /**
@@ -2142,6 +2389,22 @@ swopti_init(session_t *ps) {
   return true;
 }
 
+/**
+ * Initialize the frame scheduler of --frame-pacing.
+ */
+static void
+pacing_init(session_t *ps) {
+  ps->pacing = ccalloc(1, struct frame_pacing);
+
+  // Without a known refresh rate, it is estimated from vblank times
+  ps->refresh_rate = ps->o.refresh_rate;
+  if (ps->refresh_rate)
+    ps->refresh_intv = US_PER_SEC / ps->refresh_rate;
+  else if (ps->randr_exists)
+    update_refresh_rate(ps);
+  pacing_set_refresh_interval(ps->pacing, ps->refresh_intv);
+}
+
 /**
  * Modify a struct timeval timeout value to render at a fixed pace.
  *
@@ -2175,8 +2438,9 @@ swopti_handle_timeout(session_t *ps) {
 static bool
 init_overlay(session_t *ps) {
   xcb_composite_get_overlay_window_reply_t *reply =
-    xcb_composite_get_overlay_window_reply(ps->c,
-        xcb_composite_get_overlay_window(ps->c, ps->root), NULL);
+    X_ROUND_TRIP("composite_get_overlay_window",
+      xcb_composite_get_overlay_window_reply(ps->c,
+        xcb_composite_get_overlay_window(ps->c, ps->root), NULL));
   if (reply) {
     ps->overlay = reply->overlay_win;
     free(reply);
@@ -2249,12 +2513,46 @@ redir_start(session_t *ps) {
     x_sync(ps->c);
 
     ps->redirected = true;
+    ps->preprocess_all = true;
 
     // Repaint the whole screen
     force_repaint(ps);
   }
 }
 
+/**
+ * Free painting resources until painting resumes.
+ */
+static void
+release_resources(session_t *ps) {
+  ps->release_before = render_resource_bytes(ps);
+  pause_render(ps);
+  ps->release_after = render_resource_bytes(ps);
+  ps->releases++;
+  log_debug("Freed painting resources, about %zu KiB before and %zu KiB after.",
+      ps->release_before / 1024, ps->release_after / 1024);
+}
+
+/**
+ * Free the largest painting resources if they are over --resource-budget.
+ */
+static void
+check_resource_budget(session_t *ps, long now) {
+  // Freeing what the next frame needs makes it rebuild that, don't do it
+  // more than once a second
+  if (now - ps->budget_checked < 1000000L)
+    return;
+  ps->budget_checked = now;
+
+  size_t freed = render_evict_resources(ps, ps->o.resource_budget * 1024 * 1024);
+  if (freed) {
+    ps->evictions++;
+    ps->evicted += freed;
+    log_debug("Freed about %zu KiB of painting resources to stay within the "
+        "budget.", freed / 1024);
+  }
+}
+
 /**
  * Unredirect all windows.
  */
@@ -2262,6 +2560,9 @@ static void
 redir_stop(session_t *ps) {
   if (ps->redirected) {
     log_trace("Screen unredirected.");
+    // Nothing is painted until the screen is redirected again
+    ev_timer_stop(ps->loop, &ps->release_timer);
+    release_resources(ps);
     // Destroy all Pictures as they expire once windows are unredirected
     // If we don't destroy them here, looks like the resources are just
     // kept inaccessible somehow
@@ -2278,18 +2579,134 @@ redir_stop(session_t *ps) {
     x_sync(ps->c);
 
     ps->redirected = false;
+    ps->preprocess_all = true;
   }
 }
 
-// Handle queued events before we go to sleep
+/**
+ * Whether an event can be handled after structural events that came after
+ * it. The handlers of these read the current state from the X server, so
+ * handling them late, or once for several of them, gives the same result.
+ */
+static inline bool
+ev_is_deferrable(session_t *ps, xcb_generic_event_t *ev) {
+  return ev->response_type == PropertyNotify
+    || ev->response_type == ps->damage_event + XCB_DAMAGE_NOTIFY;
+}
+
+/**
+ * Whether two deferrable events would be handled the same way.
+ */
+static inline bool
+ev_is_equivalent(xcb_generic_event_t *a, xcb_generic_event_t *b) {
+  if (a->response_type != b->response_type)
+    return false;
+  if (a->response_type == PropertyNotify) {
+    auto pa = (xcb_property_notify_event_t *)a;
+    auto pb = (xcb_property_notify_event_t *)b;
+    return pa->window == pb->window && pa->atom == pb->atom;
+  }
+  auto da = (xcb_damage_notify_event_t *)a;
+  auto db = (xcb_damage_notify_event_t *)b;
+  return da->damage == db->damage;
+}
+
+/**
+ * Put off an event until structural events are handled, or drop it if an
+ * equivalent one is already waiting.
+ */
 static void
-handle_queued_x_events(EV_P_ ev_prepare *w, int revents) {
-  session_t *ps = session_ptr(w, event_check);
+ev_defer(session_t *ps, xcb_generic_event_t *ev) {
+  for (int i = 0; i < ps->ndeferred_events; i++) {
+    if (ev_is_equivalent(ps->deferred_events[i], ev)) {
+      ps->events_coalesced++;
+      free(ev);
+      return;
+    }
+  }
+
+  if (ps->ndeferred_events == ps->deferred_events_cap) {
+    ps->deferred_events_cap = max_i(ps->deferred_events_cap * 2, 64);
+    ps->deferred_events =
+      crealloc(ps->deferred_events, ps->deferred_events_cap);
+  }
+  ps->deferred_events[ps->ndeferred_events++] = ev;
+  ps->events_deferred++;
+}
+
+/**
+ * Handle queued X events until the time budget of this loop iteration runs
+ * out, or a frame is due.
+ *
+ * Structural events are handled first and in order, damage and property
+ * changes after them. At least one event is handled, so they can't be held
+ * back forever.
+ *
+ * @return whether events are left for the next iteration
+ */
+static bool
+handle_queued_x_events_budgeted(session_t *ps) {
+  long now = pacing_now();
+  long deadline = now + (long)ps->o.event_budget * 1000;
+  // Give way to the next frame
+  if (ev_is_active(&ps->delayed_draw_timer))
+    deadline = min_l(deadline,
+        now + (long)(ev_timer_remaining(ps->loop, &ps->delayed_draw_timer) * 1e6));
+  else if (ev_is_active(&ps->draw_idle))
+    deadline = now;
+
+  bool handled = false, out_of_time = false;
   xcb_generic_event_t *ev;
   while ((ev = xcb_poll_for_queued_event(ps->c))) {
+    if (ev_is_deferrable(ps, ev)) {
+      ev_defer(ps, ev);
+    } else {
+      ev_handle(ps, ev);
+      free(ev);
+      handled = true;
+    }
+    if (handled && pacing_now() >= deadline) {
+      out_of_time = true;
+      break;
+    }
+  }
+
+  int i = 0;
+  while (i < ps->ndeferred_events && (!handled || pacing_now() < deadline)) {
+    ev = ps->deferred_events[i++];
     ev_handle(ps, ev);
     free(ev);
-  };
+    handled = true;
+  }
+  ps->ndeferred_events -= i;
+  memmove(ps->deferred_events, ps->deferred_events + i,
+      ps->ndeferred_events * sizeof(*ps->deferred_events));
+
+  ps->event_backlog_max = max_i(ps->event_backlog_max, ps->ndeferred_events);
+  if (out_of_time || ps->ndeferred_events) {
+    ps->event_budget_overruns++;
+    return true;
+  }
+  return false;
+}
+
+// Handle queued events before we go to sleep
+static void
+handle_queued_x_events(EV_P_ ev_prepare *w, int revents) {
+  session_t *ps = session_ptr(w, event_check);
+  long lap = pacing_now();
+  if (ps->o.event_budget) {
+    // Don't go to sleep with events left, new events might depend on them
+    if (handle_queued_x_events_budgeted(ps))
+      ev_idle_start(ps->loop, &ps->event_idle);
+  } else {
+    xcb_generic_event_t *ev;
+    while ((ev = xcb_poll_for_queued_event(ps->c))) {
+      ev_handle(ps, ev);
+      free(ev);
+    };
+  }
+  frame_timing_lap(ps->timing, FRAME_STAGE_EVENTS, &lap);
   // Flush because if we go into sleep when there is still
   // requests in the outgoing buffer, they will not be sent
   // for an indefinite amount of time.
@@ -2311,15 +2728,49 @@ static void
 tmout_unredir_callback(EV_P_ ev_timer *w, int revents) {
   session_t *ps = session_ptr(w, unredir_timer);
   ps->tmout_unredir_hit = true;
+  ps->preprocess_all = true;
   queue_redraw(ps);
 }
 
+/**
+ * Repair the windows whose held back damage is due.
+ */
+static void
+damage_rate_timer_callback(EV_P_ ev_timer *w, int revents) {
+  session_t *ps = session_ptr(w, damage_rate_timer);
+  long now = pacing_now();
+  for (win *i = ps->list; i; i = i->next) {
+    if (!i->damage_held || i->damage_next > now)
+      continue;
+    i->damage_held = false;
+    if (i->damage_rate_limit)
+      i->damage_next = now + US_PER_SEC / i->damage_rate_limit;
+    repair_win(ps, i);
+  }
+  schedule_held_damage(ps, now);
+  queue_redraw(ps);
+}
+
+static void
+release_timer_callback(EV_P_ ev_timer *w, int revents) {
+  session_t *ps = session_ptr(w, release_timer);
+  ev_timer_stop(ps->loop, w);
+  if (ps->redirected)
+    release_resources(ps);
+}
+
 static void
 fade_timer_callback(EV_P_ ev_timer *w, int revents) {
   session_t *ps = session_ptr(w, fade_timer);
   queue_redraw(ps);
 }
 
+static void
+heatmap_timer_callback(EV_P_ ev_timer *w, int revents) {
+  session_t *ps = session_ptr(w, heatmap_timer);
+  queue_redraw(ps);
+}
+
 static void
 _draw_callback(EV_P_ session_t *ps, int revents) {
   if (ps->o.benchmark) {
@@ -2336,14 +2787,34 @@ _draw_callback(EV_P_ session_t *ps, int revents) {
     }
   }
 
+  // Wait for the previous frame to be shown. resume_redraw() restarts
+  // drawing, ps->redraw_needed stays true in the meantime.
+  if (!vsync_can_paint(ps))
+    return;
+
+  long lap = pacing_now();
+  if (ps->pacing)
+    pacing_frame_begin(ps->pacing, lap);
+  frame_timing_begin(ps->timing, lap);
+  round_trip_frame_begin();
+  PROBE(frame_begin, ps->timing->frames);
+
   ps->fade_running = false;
+  ps->fade_next = 0;
+  long span = lap;
+  record_frame();
   win *t = paint_preprocess(ps, ps->list);
   ps->tmout_unredir_hit = false;
 
-  // Start/stop fade timer depends on whether window are fading
-  if (!ps->fade_running && ev_is_active(&ps->fade_timer))
-    ev_timer_stop(ps->loop, &ps->fade_timer);
-  else if (ps->fade_running && !ev_is_active(&ps->fade_timer)) {
+  frame_timing_lap(ps->timing, FRAME_STAGE_PREPROCESS, &lap);
+  trace_span(ps->trace, "paint_preprocess", "paint", span, lap, NULL, 0);
+  if (ps->pacing)
+    pacing_stage_end(ps->pacing, PACING_STAGE_PREPROCESS, lap);
+
+  // Wake up when the next fading window changes its alpha, frames in
+  // between would paint the same thing
+  ev_timer_stop(ps->loop, &ps->fade_timer);
+  if (ps->fade_running) {
     ev_timer_set(&ps->fade_timer, fade_timeout(ps), 0);
     ev_timer_start(ps->loop, &ps->fade_timer);
   }
@@ -2358,8 +2829,22 @@ _draw_callback(EV_P_ session_t *ps, int revents) {
       exit(0);
   }
 
-  if (!ps->fade_running)
-    ps->fade_time = 0L;
+  long now = pacing_now();
+  if (ps->pacing)
+    pacing_frame_end(ps->pacing, now);
+  frame_timing_end(ps->timing, now, ps->o.timing_log_interval);
+  round_trip_end();
+  // One more frame than frame_begin if something was painted
+  PROBE(frame_end, ps->timing->frames);
+  if (ps->o.resource_budget)
+    check_resource_budget(ps, now);
+
+  // Keep painting the heat map while it cools down
+  ev_timer_stop(ps->loop, &ps->heatmap_timer);
+  if (ps->heatmap && ps->heatmap->hot) {
+    ev_timer_set(&ps->heatmap_timer, HEATMAP_REPAINT_US / 1e6, 0);
+    ev_timer_start(ps->loop, &ps->heatmap_timer);
+  }
 
   ps->redraw_needed = false;
 }
@@ -2389,12 +2874,16 @@ delayed_draw_timer_callback(EV_P_ ev_timer *w, int revents) {
 
 static void
 delayed_draw_callback(EV_P_ ev_idle *w, int revents) {
-  // This function is only used if we are using --swopti
+  // This function is only used if we are using --swopti or --frame-pacing
   session_t *ps = session_ptr(w, draw_idle);
   assert(ps->redraw_needed);
   assert(!ev_is_active(&ps->delayed_draw_timer));
 
-  double delay = swopti_handle_timeout(ps);
+  double delay;
+  if (ps->pacing)
+    delay = pacing_frame_delay(ps->pacing, pacing_now());
+  else
+    delay = swopti_handle_timeout(ps);
   if (delay < 1e-6) {
     if (!ps->o.benchmark) {
       ev_idle_stop(ps->loop, &ps->draw_idle);
@@ -2421,11 +2910,24 @@ delayed_draw_callback(EV_P_ ev_idle *w, int revents) {
 static void
 x_event_callback(EV_P_ ev_io *w, int revents) {
   session_t *ps = (session_t *)w;
+  long lap = pacing_now();
   xcb_generic_event_t *ev = xcb_poll_for_event(ps->c);
-  if (ev) {
+  if (!ev)
+    return;
+  if (ps->o.event_budget && ev_is_deferrable(ps, ev)) {
+    ev_defer(ps, ev);
+  } else {
     ev_handle(ps, ev);
     free(ev);
   }
+  frame_timing_lap(ps->timing, FRAME_STAGE_EVENTS, &lap);
+}
+
+static void
+event_idle_callback(EV_P_ ev_idle *w, int revents) {
+  // Nothing to do, the events left are handled when the loop iteration
+  // ends, this only keeps it from going to sleep
+  ev_idle_stop(EV_A_ w);
 }
 
 /**
@@ -2440,6 +2942,15 @@ reset_enable(EV_P_ ev_signal *w, int revents) {
   ev_break(ps->loop, EVBREAK_ALL);
 }
 
+/**
+ * Turn tracing on if it is off, and off if it is on.
+ */
+static void
+trace_toggle(EV_P_ ev_signal *w, int revents) {
+  session_t *ps = session_ptr(w, usr2_signal);
+  set_tracing(ps, !ps->trace);
+}
+
 static void
 exit_enable(EV_P_ ev_signal *w, int revents) {
   session_t *ps = session_ptr(w, int_signal);
@@ -2491,6 +3002,8 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
       .unredir_if_possible = false,
       .unredir_if_possible_blacklist = NULL,
       .unredir_if_possible_delay = 0,
+      .release_resources_delay = 0,
+      .resource_budget = 0,
       .redirected_force = UNSET,
       .stoppaint_force = UNSET,
       .dbus = false,
@@ -2500,6 +3013,9 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
 
       .refresh_rate = 0,
       .sw_opti = false,
+      .frame_pacing = false,
+      .event_budget = 0,
+      .timing_log_interval = 0,
       .vsync = VSYNC_NONE,
       .vsync_aggressive = false,
 
@@ -2518,6 +3034,7 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
       .fade_in_step = 0.028 * OPAQUE,
       .fade_out_step = 0.03 * OPAQUE,
       .fade_delta = 10,
+      .fade_easing = FADE_EASING_LINEAR,
       .no_fading_openclose = false,
       .no_fading_destroyed_argb = false,
       .fade_blacklist = NULL,
@@ -2533,10 +3050,14 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
       .blur_background_fixed = false,
       .blur_background_blacklist = NULL,
       .blur_kerns = { NULL },
+      .blur_method = BLUR_METHOD_KERNEL,
+      .blur_strength = 1.5,
+      .blur_iterations = 3,
       .inactive_dim = 0.0,
       .inactive_dim_fixed = false,
       .invert_color_list = NULL,
       .opacity_rules = NULL,
+      .damage_rate_rules = NULL,
 
       .use_ewmh_active_win = false,
       .focus_blacklist = NULL,
@@ -2552,7 +3073,8 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
     .redirected = false,
     .alpha_picts = NULL,
     .fade_running = false,
-    .fade_time = 0L,
+    .preprocess_all = true,
+    .fade_next = 0L,
     .ignore_head = NULL,
     .ignore_tail = NULL,
     .quit = false,
@@ -2594,6 +3116,10 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
     .randr_exists = 0,
     .randr_event = 0,
     .randr_error = 0,
+    .present_exists = false,
+    .present_opcode = 0,
+    .present_eid = XCB_NONE,
+    .present_cur = -1,
 #ifdef CONFIG_OPENGL
     .glx_exists = false,
     .glx_event = 0,
@@ -2633,6 +3159,7 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
   *ps = s_def;
   ps->loop = EV_DEFAULT;
   pixman_region32_init(&ps->screen_reg);
+  pixman_region32_init(&ps->vblank_commit_region);
 
   ps_g = ps;
   ps->ignore_tail = &ps->ignore_head;
@@ -2763,6 +3290,7 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
         c2_list_postprocess(ps, ps->o.blur_background_blacklist) &&
         c2_list_postprocess(ps, ps->o.invert_color_list) &&
         c2_list_postprocess(ps, ps->o.opacity_rules) &&
+        c2_list_postprocess(ps, ps->o.damage_rate_rules) &&
         c2_list_postprocess(ps, ps->o.focus_blacklist))) {
     log_error("Post-processing of conditionals failed, some of your rules might not work");
   }
@@ -2794,7 +3322,9 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
                                       NULL);
     if (r) {
       ps->present_exists = true;
+      ps->present_opcode = ext_info->major_opcode;
     }
+    free(r);
   }
 
   // Query X Sync
@@ -2883,11 +3413,25 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
   // Initialize software optimization
   if (ps->o.sw_opti)
     ps->o.sw_opti = swopti_init(ps);
-
-  // Monitor screen changes if vsync_sw is enabled and we are using
-  // an auto-detected refresh rate, or when Xinerama features are enabled
-  if (ps->randr_exists && ((ps->o.sw_opti && !ps->o.refresh_rate)
-        || ps->o.xinerama_shadow_crop))
+  if (ps->o.frame_pacing)
+    pacing_init(ps);
+  ps->latency = ccalloc(1, struct latency_stats);
+  ps->timing = ccalloc(1, struct frame_timing);
+  if (ps->o.monitor_repaint)
+    ps->heatmap = ccalloc(1, struct heatmap);
+
+  // Frames are checked against the refresh interval for missed vblanks
+  if (!ps->refresh_intv) {
+    ps->refresh_rate = ps->o.refresh_rate;
+    if (ps->refresh_rate)
+      ps->refresh_intv = US_PER_SEC / ps->refresh_rate;
+    else if (ps->randr_exists)
+      update_refresh_rate(ps);
+  }
+
+  // Monitor screen changes if we are using an auto-detected refresh rate,
+  // or when Xinerama features are enabled
+  if (ps->randr_exists && (!ps->o.refresh_rate || ps->o.xinerama_shadow_crop))
     xcb_randr_select_input(ps->c, ps->root, XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE);
 
   cxinerama_upd_scrs(ps);
@@ -2913,20 +3457,32 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
   }
 
   ev_io_init(&ps->xiow, x_event_callback, ConnectionNumber(ps->dpy), EV_READ);
+  ev_idle_init(&ps->event_idle, event_idle_callback);
+  if (ps->o.event_budget) {
+    // Idle watchers only run when nothing of the same or higher priority is
+    // pending, so keep a busy X connection from starving drawing
+    ev_set_priority(&ps->xiow, EV_MINPRI);
+    ev_set_priority(&ps->event_idle, EV_MINPRI);
+  }
   ev_io_start(ps->loop, &ps->xiow);
   ev_init(&ps->unredir_timer, tmout_unredir_callback);
-  if (ps->o.sw_opti)
+  if (ps->o.sw_opti || ps->o.frame_pacing)
     ev_idle_init(&ps->draw_idle, delayed_draw_callback);
   else
     ev_idle_init(&ps->draw_idle, draw_callback);
 
   ev_init(&ps->fade_timer, fade_timer_callback);
+  ev_init(&ps->heatmap_timer, heatmap_timer_callback);
+  ev_init(&ps->damage_rate_timer, damage_rate_timer_callback);
+  ev_init(&ps->release_timer, release_timer_callback);
   ev_init(&ps->delayed_draw_timer, delayed_draw_timer_callback);
 
   // Set up SIGUSR1 signal handler to reset program
   ev_signal_init(&ps->usr1_signal, reset_enable, SIGUSR1);
+  ev_signal_init(&ps->usr2_signal, trace_toggle, SIGUSR2);
   ev_signal_init(&ps->int_signal, exit_enable, SIGINT);
   ev_signal_start(ps->loop, &ps->usr1_signal);
+  ev_signal_start(ps->loop, &ps->usr2_signal);
   ev_signal_start(ps->loop, &ps->int_signal);
 
   // xcb can read multiple events from the socket when a request with reply is
@@ -2964,12 +3520,24 @@ session_init(int argc, char **argv, Display *dpy, const char *config_file,
 #endif
   }
 
+  // Recording starts with the windows that already exist, so a replay
+  // starts with them too
+  if (ps->o.record_events && !record_start(ps->o.record_events, ps->root))
+    exit(1);
+  if (ps->o.replay_events) {
+    if (!replay_start(ps->o.replay_events, ps->root))
+      exit(1);
+    // Recorded windows don't exist on this X server, don't try to paint them
+    ps->o.redirected_force = OFF;
+  }
+
   {
     xcb_window_t *children;
     int nchildren;
 
-    xcb_query_tree_reply_t *reply = xcb_query_tree_reply(ps->c,
-        xcb_query_tree(ps->c, ps->root), NULL);
+    xcb_query_tree_reply_t *reply = record_reply(RECORD_TAG_QUERY_TREE,
+        X_ROUND_TRIP("query_tree",
+          xcb_query_tree_reply(ps->c, xcb_query_tree(ps->c, ps->root), NULL)));
 
     if (reply) {
       children = xcb_query_tree_children(reply);
@@ -3035,6 +3603,8 @@ session_destroy(session_t *ps) {
     win *list = ps->list;
     ps->list = NULL;
 
+    ps->changed_list = NULL;
+    ps->paint_top = NULL;
     for (win *w = list; w; w = next) {
       next = w->next;
 
@@ -3053,6 +3623,7 @@ session_destroy(session_t *ps) {
   free_wincondlst(&ps->o.invert_color_list);
   free_wincondlst(&ps->o.blur_background_blacklist);
   free_wincondlst(&ps->o.opacity_rules);
+  free_wincondlst(&ps->o.damage_rate_rules);
   free_wincondlst(&ps->o.paint_blacklist);
   free_wincondlst(&ps->o.unredir_if_possible_blacklist);
 
@@ -3098,14 +3669,38 @@ session_destroy(session_t *ps) {
 
   free(ps->o.write_pid_path);
   free(ps->o.logpath);
+  free(ps->o.trace_file);
+  free(ps->o.record_events);
+  free(ps->o.replay_events);
   for (int i = 0; i < MAX_BLUR_PASS; ++i) {
     free(ps->o.blur_kerns[i]);
     free(ps->blur_kerns_cache[i]);
   }
   free(ps->o.glx_fshader_win_str);
   free_xinerama_info(ps);
+  free(ps->pacing);
+  ps->pacing = NULL;
+  free(ps->latency);
+  ps->latency = NULL;
+  free(ps->timing);
+  ps->timing = NULL;
+  heatmap_free(ps->heatmap);
+  ps->heatmap = NULL;
+  set_tracing(ps, false);
+  record_stop();
+  if (log_get_level_tls() <= LOG_LEVEL_DEBUG) {
+    char *report = round_trip_report(ps, ev_type_name);
+    log_debug("Round trips to the X server:\n%s", report ? report : "");
+    free(report);
+  }
+  for (int i = 0; i < ps->ndeferred_events; i++)
+    free(ps->deferred_events[i]);
+  free(ps->deferred_events);
+  ps->deferred_events = NULL;
+  ps->ndeferred_events = ps->deferred_events_cap = 0;
 
   deinit_render(ps);
+  pixman_region32_fini(&ps->vblank_commit_region);
 
 #ifdef CONFIG_VSYNC_DRM
   // Close file opened for DRM VSync
@@ -3144,9 +3739,14 @@ session_destroy(session_t *ps) {
   // Stop libev event handlers
   ev_timer_stop(ps->loop, &ps->unredir_timer);
   ev_timer_stop(ps->loop, &ps->fade_timer);
+  ev_timer_stop(ps->loop, &ps->heatmap_timer);
+  ev_timer_stop(ps->loop, &ps->damage_rate_timer);
+  ev_timer_stop(ps->loop, &ps->release_timer);
   ev_idle_stop(ps->loop, &ps->draw_idle);
+  ev_idle_stop(ps->loop, &ps->event_idle);
   ev_prepare_stop(ps->loop, &ps->event_check);
   ev_signal_stop(ps->loop, &ps->usr1_signal);
+  ev_signal_stop(ps->loop, &ps->usr2_signal);
   ev_signal_stop(ps->loop, &ps->int_signal);
 
   if (ps == ps_g)
@@ -3155,6 +3755,36 @@ session_destroy(session_t *ps) {
   log_deinit_tls();
 }
 
+/**
+ * Feed recorded events to the event handlers as fast as possible, and log
+ * how long handling them and preprocessing frames took.
+ */
+static void
+replay_events(session_t *ps) {
+  unsigned long nevents = 0, nframes = 0;
+  long handling = 0, preprocessing = 0;
+  xcb_generic_event_t *ev = NULL;
+  enum record_type type;
+
+  while ((type = replay_next(&ev)) != RECORD_END) {
+    long start = pacing_now();
+    if (type == RECORD_EVENT) {
+      ev_handle(ps, ev);
+      free(ev);
+      handling += pacing_now() - start;
+      nevents++;
+    } else {
+      paint_preprocess(ps, ps->list);
+      preprocessing += pacing_now() - start;
+      nframes++;
+    }
+  }
+
+  log_info("Handled %lu events in %ld us, preprocessed %lu frames in %ld us.",
+      nevents, handling, nframes, preprocessing);
+  ps->quit = true;
+}
+
 /**
  * Do the actual work.
  *
@@ -3172,6 +3802,11 @@ session_run(session_t *ps) {
   if (ps->redirected)
     paint_all(ps, t, true);
 
+  if (ps->o.replay_events) {
+    replay_events(ps);
+    return;
+  }
+
   // In benchmark mode, we want draw_idle handler to always be active
   if (ps->o.benchmark)
     ev_idle_start(ps->loop, &ps->draw_idle);
@@ -3179,6 +3814,7 @@ session_run(session_t *ps) {
   ev_run(ps->loop, 0);
 }
 
+#ifndef COMPTON_NO_MAIN
 /**
  * The function that everybody knows.
  */
@@ -3227,6 +3863,13 @@ main(int argc, char **argv) {
 
   // Main loop
   bool quit = false;
+#ifdef CONFIG_OPENGL
+  // The VSync thread of --vsync opengl and opengl-oml uses Xlib too. That
+  // method can come from the configuration file, which is read after the
+  // display is opened, or be picked over D-Bus later, so this can't wait
+  // until we know.
+  XInitThreads();
+#endif
   Display *dpy = XOpenDisplay(NULL);
   if (!dpy) {
     log_fatal("Can't open display.");
@@ -3271,5 +3914,6 @@ main(int argc, char **argv) {
 
   return 0;
 }
+#endif
 
 // vim: set et sw=2 :
@@ -343,6 +343,35 @@ bool parse_rule_opacity(c2_lptr_t **res, const char *src) {
   return c2_parse(res, endptr, (void *) val);
 }
 
+/**
+ * Parse a list of damage rate rules.
+ */
+bool parse_rule_damage_rate(c2_lptr_t **res, const char *src) {
+  // Find rate value
+  char *endptr = NULL;
+  long val = strtol(src, &endptr, 0);
+  if (!endptr || endptr == src) {
+    log_error("No damage rate specified: %s", src);
+    return false;
+  }
+  if (val > 1000 || val < 1) {
+    log_error("Damage rate %ld invalid: %s", val, src);
+    return false;
+  }
+
+  // Skip over spaces
+  while (*endptr && isspace(*endptr))
+    ++endptr;
+  if (':' != *endptr) {
+    log_error("Damage rate terminator not found: %s", src);
+    return false;
+  }
+  ++endptr;
+
+  // Parse pattern
+  return c2_parse(res, endptr, (void *) val);
+}
+
 /**
  * Add a pattern to a condition linked list.
  */
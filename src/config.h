@@ -35,6 +35,8 @@ typedef enum {
 	VSYNC_OPENGL_OML,
 	VSYNC_OPENGL_SWC,
 	VSYNC_OPENGL_MSWC,
+	VSYNC_PRESENT,
+	VSYNC_DRM_EVENT,
 	NUM_VSYNC,
 } vsync_t;
 
@@ -46,6 +48,28 @@ enum backend {
 	NUM_BKEND,
 };
 
+/// Background blur algorithms.
+enum blur_method {
+	/// Run the convolution kernels in blur_kerns at full resolution.
+	BLUR_METHOD_KERNEL,
+	/// Dual-Kawase: downsample and upsample through a chain of half-sized
+	/// textures. Cost barely depends on the blur radius.
+	BLUR_METHOD_DUAL_KAWASE,
+	NUM_BLUR_METHOD,
+};
+
+/// Easing curves of fading.
+enum fade_easing {
+	FADE_EASING_LINEAR,
+	/// Start slow, end fast.
+	FADE_EASING_IN,
+	/// Start fast, end slow.
+	FADE_EASING_OUT,
+	/// Slow at both ends.
+	FADE_EASING_IN_OUT,
+	NUM_FADE_EASING,
+};
+
 typedef struct win_option_mask {
 	bool shadow : 1;
 	bool fade : 1;
@@ -71,6 +95,8 @@ typedef struct _c2_lptr c2_lptr_t;
 // rendering.
 /// @brief Maximum passes for blur.
 #define MAX_BLUR_PASS 5
+/// @brief Maximum number of downsampling steps of the dual-Kawase blur.
+#define MAX_BLUR_ITERATIONS 8
 
 /// Structure representing all options.
 typedef struct options_t {
@@ -90,6 +116,11 @@ typedef struct options_t {
 	bool glx_no_stencil;
 	/// Whether to avoid rebinding pixmap on window damage.
 	bool glx_no_rebind_pixmap;
+	/// Whether to always rebind pixmap on window damage, instead of probing
+	/// whether the driver needs it.
+	bool glx_force_rebind_pixmap;
+	/// Whether to avoid caching linked GLSL program binaries on disk.
+	bool glx_no_program_cache;
 	/// GLX swap method we assume OpenGL uses.
 	int glx_swap_method;
 	/// Whether to use GL_EXT_gpu_shader4 to (hopefully) accelerates blurring.
@@ -110,6 +141,12 @@ typedef struct options_t {
 	c2_lptr_t *unredir_if_possible_blacklist;
 	/// Delay before unredirecting screen, in milliseconds.
 	unsigned long unredir_if_possible_delay;
+	/// Time without damage after which painting resources are freed, in
+	/// milliseconds. 0 to never free them.
+	unsigned long release_resources_delay;
+	/// Size of painting resources above which the largest ones that can be
+	/// rebuilt are freed, in MiB. 0 for no limit.
+	unsigned long resource_budget;
 	/// Forced redirection setting through D-Bus.
 	switch_t redirected_force;
 	/// Whether to stop painting. Controlled through D-Bus.
@@ -126,6 +163,10 @@ typedef struct options_t {
 	int benchmark;
 	/// Window to constantly repaint in benchmark mode. 0 for full-screen.
 	xcb_window_t benchmark_wid;
+	/// File to record handled X events to.
+	char *record_events;
+	/// File to replay X events from, instead of handling live ones.
+	char *replay_events;
 	/// A list of conditions of windows not to paint.
 	c2_lptr_t *paint_blacklist;
 	/// Whether to show all X errors.
@@ -140,6 +181,16 @@ typedef struct options_t {
 	int refresh_rate;
 	/// Whether to enable refresh-rate-based software optimization.
 	bool sw_opti;
+	/// Whether to start frames based on predicted render time.
+	bool frame_pacing;
+	/// Time X events may be handled for in a main loop iteration, in
+	/// milliseconds. 0 to handle all of them.
+	unsigned long event_budget;
+	/// Interval between frame timing summaries logged, in seconds. 0 for
+	/// none.
+	unsigned long timing_log_interval;
+	/// File traces are written to, when tracing is turned on.
+	char *trace_file;
 	/// VSync method to use;
 	vsync_t vsync;
 	/// Whether to do VSync aggressively.
@@ -172,6 +223,8 @@ typedef struct options_t {
 	opacity_t fade_out_step;
 	/// Fading time delta. In milliseconds.
 	unsigned long fade_delta;
+	/// Easing curve of fading.
+	enum fade_easing fade_easing;
 	/// Whether to disable fading on window open/close.
 	bool no_fading_openclose;
 	/// Whether to disable fading on ARGB managed destroyed windows.
@@ -209,6 +262,12 @@ typedef struct options_t {
 	c2_lptr_t *blur_background_blacklist;
 	/// Blur convolution kernel.
 	xcb_render_fixed_t *blur_kerns[MAX_BLUR_PASS];
+	/// Blur algorithm.
+	enum blur_method blur_method;
+	/// Sample distance of the dual-Kawase blur, in texels of each level.
+	double blur_strength;
+	/// Number of downsampling steps of the dual-Kawase blur.
+	int blur_iterations;
 	/// How much to dim an inactive window. 0.0 - 1.0, 0 to disable.
 	double inactive_dim;
 	/// Whether to use fixed inactive dim opacity, instead of deciding
@@ -218,6 +277,8 @@ typedef struct options_t {
 	c2_lptr_t *invert_color_list;
 	/// Rules to change window opacity.
 	c2_lptr_t *opacity_rules;
+	/// Rules to limit the rate window damage is repaired at.
+	c2_lptr_t *damage_rate_rules;
 
 	// === Focus related ===
 	/// Whether to try to detect WM windows and mark them as focused.
@@ -244,6 +305,8 @@ typedef struct options_t {
 
 extern const char *const VSYNC_STRS[NUM_VSYNC + 1];
 extern const char *const BACKEND_STRS[NUM_BKEND + 1];
+extern const char *const BLUR_METHOD_STRS[NUM_BLUR_METHOD + 1];
+extern const char *const FADE_EASING_STRS[NUM_FADE_EASING + 1];
 
 attr_warn_unused_result bool parse_long(const char *, long *);
 attr_warn_unused_result const char *parse_matrix_readnum(const char *, double *);
@@ -255,6 +318,7 @@ attr_warn_unused_result bool
 parse_conv_kern_lst(const char *, xcb_render_fixed_t **, int, bool *hasneg);
 attr_warn_unused_result bool parse_geometry(session_t *, const char *, region_t *);
 attr_warn_unused_result bool parse_rule_opacity(c2_lptr_t **, const char *);
+attr_warn_unused_result bool parse_rule_damage_rate(c2_lptr_t **, const char *);
 
 /**
  * Add a pattern to a condition linked list.
@@ -353,6 +417,30 @@ static inline attr_const int parse_glx_swap_method(const char *str) {
 	return age;
 }
 
+/**
+ * Parse a blur method option argument.
+ */
+static inline attr_const enum blur_method parse_blur_method(const char *str) {
+	for (enum blur_method i = 0; BLUR_METHOD_STRS[i]; ++i)
+		if (!strcasecmp(str, BLUR_METHOD_STRS[i]))
+			return i;
+
+	log_error("Invalid blur method argument: %s", str);
+	return NUM_BLUR_METHOD;
+}
+
+/**
+ * Parse a fade easing option argument.
+ */
+static inline attr_const enum fade_easing parse_fade_easing(const char *str) {
+	for (enum fade_easing i = 0; FADE_EASING_STRS[i]; ++i)
+		if (!strcasecmp(str, FADE_EASING_STRS[i]))
+			return i;
+
+	log_error("Invalid fade easing argument: %s", str);
+	return NUM_FADE_EASING;
+}
+
 /**
  * Parse a VSync option argument.
  */
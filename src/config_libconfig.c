@@ -134,23 +134,24 @@ parse_cfg_condlst(const config_t *pcfg, c2_lptr_t **pcondlst,
 }
 
 /**
- * Parse an opacity rule list in configuration file.
+ * Parse a list of rules with values, like opacity rules, in configuration
+ * file.
  */
 static inline void
-parse_cfg_condlst_opct(options_t *opt, const config_t *pcfg, const char *name) {
+parse_cfg_condlst_rule(const config_t *pcfg, c2_lptr_t **pcondlst,
+    const char *name, bool (*parse)(c2_lptr_t **, const char *)) {
   config_setting_t *setting = config_lookup(pcfg, name);
   if (setting) {
     // Parse an array of options
     if (config_setting_is_array(setting)) {
       int i = config_setting_length(setting);
       while (i--)
-        if (!parse_rule_opacity(&opt->opacity_rules,
-                                config_setting_get_string_elem(setting, i)))
+        if (!parse(pcondlst, config_setting_get_string_elem(setting, i)))
           exit(1);
     }
     // Treat it as a single pattern if it's a string
     else if (config_setting_type(setting) == CONFIG_TYPE_STRING) {
-      if (!parse_rule_opacity(&opt->opacity_rules, config_setting_get_string(setting)))
+      if (!parse(pcondlst, config_setting_get_string(setting)))
         exit(1);
     }
   }
@@ -223,6 +224,14 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   // -O (fade_out_step)
   if (config_lookup_float(&cfg, "fade-out-step", &dval))
     opt->fade_out_step = normalize_d(dval) * OPAQUE;
+  // --fade-easing
+  if (config_lookup_string(&cfg, "fade-easing", &sval)) {
+    opt->fade_easing = parse_fade_easing(sval);
+    if (opt->fade_easing >= NUM_FADE_EASING) {
+      log_fatal("Cannot parse \"fade-easing\"");
+      exit(1);
+    }
+  }
   // -r (shadow_radius)
   config_lookup_int(&cfg, "shadow-radius", &opt->shadow_radius);
   // -o (shadow_opacity)
@@ -340,6 +349,8 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   }
   // --sw-opti
   lcfg_lookup_bool(&cfg, "sw-opti", &opt->sw_opti);
+  // --frame-pacing
+  lcfg_lookup_bool(&cfg, "frame-pacing", &opt->frame_pacing);
   // --use-ewmh-active-win
   lcfg_lookup_bool(&cfg, "use-ewmh-active-win",
       &opt->use_ewmh_active_win);
@@ -349,6 +360,23 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   // --unredir-if-possible-delay
   if (config_lookup_int(&cfg, "unredir-if-possible-delay", &ival))
     opt->unredir_if_possible_delay = ival;
+  // --event-budget
+  if (config_lookup_int(&cfg, "event-budget", &ival))
+    opt->event_budget = ival;
+  // --timing-log-interval
+  if (config_lookup_int(&cfg, "timing-log-interval", &ival))
+    opt->timing_log_interval = ival;
+  // --trace-file
+  if (config_lookup_string(&cfg, "trace-file", &sval)) {
+    free(opt->trace_file);
+    opt->trace_file = strdup(sval);
+  }
+  // --release-resources-delay
+  if (config_lookup_int(&cfg, "release-resources-delay", &ival))
+    opt->release_resources_delay = ival;
+  // --resource-budget
+  if (config_lookup_int(&cfg, "resource-budget", &ival))
+    opt->resource_budget = ival;
   // --inactive-dim-fixed
   lcfg_lookup_bool(&cfg, "inactive-dim-fixed", &opt->inactive_dim_fixed);
   // --detect-transient
@@ -367,7 +395,11 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   // --blur-background-exclude
   parse_cfg_condlst(&cfg, &opt->blur_background_blacklist, "blur-background-exclude");
   // --opacity-rule
-  parse_cfg_condlst_opct(opt, &cfg, "opacity-rule");
+  parse_cfg_condlst_rule(&cfg, &opt->opacity_rules, "opacity-rule",
+      parse_rule_opacity);
+  // --damage-rate-rule
+  parse_cfg_condlst_rule(&cfg, &opt->damage_rate_rules, "damage-rate-rule",
+      parse_rule_damage_rate);
   // --unredir-if-possible-exclude
   parse_cfg_condlst(&cfg, &opt->unredir_if_possible_blacklist, "unredir-if-possible-exclude");
   // --blur-background
@@ -378,6 +410,18 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   // --blur-background-fixed
   lcfg_lookup_bool(&cfg, "blur-background-fixed",
       &opt->blur_background_fixed);
+  // --blur-method
+  if (config_lookup_string(&cfg, "blur-method", &sval)) {
+    opt->blur_method = parse_blur_method(sval);
+    if (opt->blur_method >= NUM_BLUR_METHOD) {
+      log_fatal("Cannot parse \"blur-method\"");
+      exit(1);
+    }
+  }
+  // --blur-strength
+  config_lookup_float(&cfg, "blur-strength", &opt->blur_strength);
+  // --blur-iterations
+  config_lookup_int(&cfg, "blur-iterations", &opt->blur_iterations);
   // --blur-kern
   if (config_lookup_string(&cfg, "blur-kern", &sval) &&
       !parse_conv_kern_lst(sval, opt->blur_kerns, MAX_BLUR_PASS, conv_kern_hasneg)) {
@@ -390,6 +434,10 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
   lcfg_lookup_bool(&cfg, "glx-no-stencil", &opt->glx_no_stencil);
   // --glx-no-rebind-pixmap
   lcfg_lookup_bool(&cfg, "glx-no-rebind-pixmap", &opt->glx_no_rebind_pixmap);
+  // --glx-force-rebind-pixmap
+  lcfg_lookup_bool(&cfg, "glx-force-rebind-pixmap", &opt->glx_force_rebind_pixmap);
+  // --glx-no-program-cache
+  lcfg_lookup_bool(&cfg, "glx-no-program-cache", &opt->glx_no_program_cache);
   // --glx-swap-method
   if (config_lookup_string(&cfg, "glx-swap-method", &sval)) {
     opt->glx_swap_method = parse_glx_swap_method(sval);
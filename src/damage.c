@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <pixman.h>
+
+#include "utils.h"
+
+#include "damage.h"
+
+static inline region_t *damage_history_at(struct damage_history *h, int i) {
+	return &h->unions[(h->head + i) % h->capacity];
+}
+
+/// Replace a region by its extents when it has too many rectangles.
+static inline void damage_simplify(region_t *reg) {
+	if (pixman_region32_n_rects(reg) <= DAMAGE_MAX_RECTS)
+		return;
+	rect_t ext = *pixman_region32_extents(reg);
+	pixman_region32_fini(reg);
+	pixman_region32_init_rects(reg, &ext, 1);
+}
+
+void damage_history_init(struct damage_history *h, int capacity) {
+	capacity = max_i(min_i(capacity, DAMAGE_HISTORY_MAX_AGE), 1);
+	h->unions = ccalloc(capacity, region_t);
+	for (int i = 0; i < capacity; i++)
+		pixman_region32_init(&h->unions[i]);
+	h->capacity = capacity;
+	h->head = 0;
+	h->nframes = 1;
+}
+
+void damage_history_deinit(struct damage_history *h) {
+	for (int i = 0; i < h->capacity; i++)
+		pixman_region32_fini(&h->unions[i]);
+	free(h->unions);
+	*h = (struct damage_history){0};
+}
+
+void damage_history_add(struct damage_history *h, const region_t *damage) {
+	for (int i = 0; i < h->nframes; i++) {
+		region_t *u = damage_history_at(h, i);
+		pixman_region32_union(u, u, (region_t *)damage);
+		damage_simplify(u);
+	}
+}
+
+void damage_history_next_frame(struct damage_history *h) {
+	// The oldest union falls off the end, and is reused for the new frame.
+	// All the others now cover one more frame, and nothing has to be merged
+	// as they already include the damage added while the last frame was
+	// painted.
+	h->head = (h->head + h->capacity - 1) % h->capacity;
+	pixman_region32_clear(&h->unions[h->head]);
+	h->nframes = min_i(h->nframes + 1, h->capacity);
+	h->oldest = 0;
+}
+
+void damage_history_reset(struct damage_history *h) {
+	for (int i = 0; i < h->capacity; i++)
+		pixman_region32_clear(&h->unions[i]);
+	h->head = 0;
+	h->nframes = 1;
+	h->oldest = 0;
+}
+
+/// Keep at least `capacity` frames of history from now on.
+static void damage_history_grow(struct damage_history *h, int capacity) {
+	auto unions = ccalloc(capacity, region_t);
+	// Regions can be moved around, they don't point into themselves
+	for (int i = 0; i < h->nframes; i++)
+		unions[i] = *damage_history_at(h, i);
+	for (int i = h->nframes; i < capacity; i++)
+		pixman_region32_init(&unions[i]);
+	// Free the unused unions, which were not moved
+	for (int i = h->nframes; i < h->capacity; i++)
+		pixman_region32_fini(damage_history_at(h, i));
+	free(h->unions);
+	h->unions = unions;
+	h->capacity = capacity;
+	h->head = 0;
+}
+
+bool damage_history_get(struct damage_history *h, int age, region_t *res) {
+	if (age < 1)
+		return false;
+	if (age > h->capacity && age <= DAMAGE_HISTORY_MAX_AGE)
+		damage_history_grow(h, age);
+	if (age > h->nframes)
+		return false;
+	pixman_region32_copy(res, damage_history_at(h, age - 1));
+	return true;
+}
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+
+#include "region.h"
+
+/// Damage of recent frames, used to find out what to repaint in a back buffer
+/// of a given age.
+///
+/// Instead of the damage of each frame, the union of the damage of the latest
+/// frames is kept for every age, so the repaint region of any age is ready
+/// without merging anything. New damage is added to all of these unions, and
+/// starting a new frame only moves the ring by one.
+
+/// Largest buffer age kept track of. Older buffers are repainted in full.
+#define DAMAGE_HISTORY_MAX_AGE 16
+
+/// Unions with more rectangles than this are replaced by their extents, so
+/// adding damage and clipping to them stays cheap.
+#define DAMAGE_MAX_RECTS 32
+
+struct damage_history {
+	/// `unions[(head + i) % capacity]` is the damage of the frame being
+	/// painted and of the `i` frames before it.
+	region_t *unions;
+	/// Number of allocated unions.
+	int capacity;
+	/// Index of the union of the frame being painted.
+	int head;
+	/// Number of frames whose damage is known, including the one being painted.
+	int nframes;
+	/// When the oldest client damage in the frame being painted came in, 0 if
+	/// there is none.
+	long oldest;
+};
+
+void damage_history_init(struct damage_history *, int capacity);
+void damage_history_deinit(struct damage_history *);
+
+/// Add damage to the frame being painted.
+void damage_history_add(struct damage_history *, const region_t *damage);
+
+/// Record that client damage which came in at `when` is in the frame being
+/// painted.
+static inline void damage_history_stamp(struct damage_history *h, long when) {
+	if (when && (!h->oldest || when < h->oldest))
+		h->oldest = when;
+}
+
+/// Finish the frame being painted, and start a new one without damage.
+void damage_history_next_frame(struct damage_history *);
+
+/// Forget all damage, e.g. when the screen changes size.
+void damage_history_reset(struct damage_history *);
+
+/// Get the region to repaint in a back buffer `age` frames old.
+///
+/// Returns false if it is not known, then the whole buffer has to be
+/// repainted. More history is kept from then on if `age` is within
+/// DAMAGE_HISTORY_MAX_AGE.
+bool damage_history_get(struct damage_history *, int age, region_t *res);
@@ -26,6 +26,11 @@
 #include "win.h"
 #include "string_utils.h"
 #include "log.h"
+#include "latency.h"
+#include "pacing.h"
+#include "timing.h"
+#include "roundtrip.h"
+#include "trace.h"
 
 #include "dbus.h"
 
@@ -838,6 +843,12 @@ cdbus_process_win_get(session_t *ps, DBusMessage *msg) {
   cdbus_m_win_get_do(opacity_set, cdbus_reply_uint32);
 
   cdbus_m_win_get_do(frame_opacity, cdbus_reply_double);
+  cdbus_m_win_get_do(damage_rate_limit, cdbus_reply_int32);
+  // damage_rate
+  if (!strcmp("damage_rate", target)) {
+    cdbus_reply_double(ps, msg, win_damage_rate(w, pacing_now()));
+    return true;
+  }
   if (!strcmp("left_width", target)) {
     cdbus_reply_uint32(ps, msg, w->frame_extents.left);
     return true;
@@ -855,6 +866,23 @@ cdbus_process_win_get(session_t *ps, DBusMessage *msg) {
     return true;
   }
 
+  if (!strncmp("resource_", target, 9)) {
+    size_t bytes[NUM_RENDER_RES];
+    render_win_resource_bytes(ps, w, bytes);
+    for (int i = 0; i < NUM_RENDER_RES; i++) {
+      char key[32];
+      snprintf(key, sizeof(key), "resource_%s_kib", RENDER_RES_NAMES[i]);
+      if (!strcmp(key, target)) {
+        cdbus_reply_uint32(ps, msg, bytes[i] / 1024);
+        return true;
+      }
+    }
+    if (!strcmp("resource_kib", target)) {
+      cdbus_reply_uint32(ps, msg, render_resource_total(bytes) / 1024);
+      return true;
+    }
+  }
+
   cdbus_m_win_get_do(shadow, cdbus_reply_bool);
   cdbus_m_win_get_do(fade, cdbus_reply_bool);
   cdbus_m_win_get_do(invert_color, cdbus_reply_bool);
@@ -1038,6 +1066,11 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
   }
   cdbus_m_opts_get_do(unredir_if_possible, cdbus_reply_bool);
   cdbus_m_opts_get_do(unredir_if_possible_delay, cdbus_reply_int32);
+  cdbus_m_opts_get_do(release_resources_delay, cdbus_reply_int32);
+  cdbus_m_opts_get_do(resource_budget, cdbus_reply_int32);
+  cdbus_m_opts_get_do(event_budget, cdbus_reply_int32);
+  cdbus_m_opts_get_do(timing_log_interval, cdbus_reply_int32);
+  cdbus_m_opts_get_do(trace_file, cdbus_reply_string);
   cdbus_m_opts_get_do(redirected_force, cdbus_reply_enum);
   cdbus_m_opts_get_do(stoppaint_force, cdbus_reply_enum);
   cdbus_m_opts_get_do(logpath, cdbus_reply_string);
@@ -1045,6 +1078,7 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
 
   cdbus_m_opts_get_do(refresh_rate, cdbus_reply_int32);
   cdbus_m_opts_get_do(sw_opti, cdbus_reply_bool);
+  cdbus_m_opts_get_do(frame_pacing, cdbus_reply_bool);
   if (!strcmp("vsync", target)) {
     assert(ps->o.vsync < sizeof(VSYNC_STRS) / sizeof(VSYNC_STRS[0]));
     cdbus_reply_string(ps, msg, VSYNC_STRS[ps->o.vsync]);
@@ -1055,6 +1089,11 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
     cdbus_reply_string(ps, msg, BACKEND_STRS[ps->o.backend]);
     return true;
   }
+  if (!strcmp("blur_method", target)) {
+    assert(ps->o.blur_method < sizeof(BLUR_METHOD_STRS) / sizeof(BLUR_METHOD_STRS[0]));
+    cdbus_reply_string(ps, msg, BLUR_METHOD_STRS[ps->o.blur_method]);
+    return true;
+  }
   cdbus_m_opts_get_stub(dbe, cdbus_reply_bool, false);
   cdbus_m_opts_get_do(vsync_aggressive, cdbus_reply_bool);
 
@@ -1071,11 +1110,18 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
   cdbus_m_opts_get_do(fade_delta, cdbus_reply_int32);
   cdbus_m_opts_get_do(fade_in_step, cdbus_reply_int32);
   cdbus_m_opts_get_do(fade_out_step, cdbus_reply_int32);
+  if (!strcmp("fade_easing", target)) {
+    assert(ps->o.fade_easing < sizeof(FADE_EASING_STRS) / sizeof(FADE_EASING_STRS[0]));
+    cdbus_reply_string(ps, msg, FADE_EASING_STRS[ps->o.fade_easing]);
+    return true;
+  }
   cdbus_m_opts_get_do(no_fading_openclose, cdbus_reply_bool);
 
   cdbus_m_opts_get_do(blur_background, cdbus_reply_bool);
   cdbus_m_opts_get_do(blur_background_frame, cdbus_reply_bool);
   cdbus_m_opts_get_do(blur_background_fixed, cdbus_reply_bool);
+  cdbus_m_opts_get_do(blur_strength, cdbus_reply_double);
+  cdbus_m_opts_get_do(blur_iterations, cdbus_reply_int32);
 
   cdbus_m_opts_get_do(inactive_dim, cdbus_reply_double);
   cdbus_m_opts_get_do(inactive_dim_fixed, cdbus_reply_bool);
@@ -1089,6 +1135,8 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
   cdbus_m_opts_get_stub(glx_copy_from_front, cdbus_reply_bool, false);
   cdbus_m_opts_get_do(glx_no_stencil, cdbus_reply_bool);
   cdbus_m_opts_get_do(glx_no_rebind_pixmap, cdbus_reply_bool);
+  cdbus_m_opts_get_do(glx_force_rebind_pixmap, cdbus_reply_bool);
+  cdbus_m_opts_get_do(glx_no_program_cache, cdbus_reply_bool);
   cdbus_m_opts_get_do(glx_swap_method, cdbus_reply_int32);
 #endif
 
@@ -1104,6 +1152,193 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
   return true;
 }
 
+/**
+ * Process a timing_get D-Bus request.
+ */
+static bool
+cdbus_process_timing_get(session_t *ps, DBusMessage *msg) {
+  const char *stage = NULL;
+  const char *stat = NULL;
+
+  if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_STRING, &stage))
+    return false;
+
+  if (!strcmp("frames", stage)) {
+    cdbus_reply_uint32(ps, msg, ps->timing->frames);
+    return true;
+  }
+
+  if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_STRING, &stat))
+    return false;
+
+  enum frame_stage s = frame_stage_from_name(stage);
+  if (s == NUM_FRAME_STAGES) {
+    log_error(CDBUS_ERROR_BADTGT_S, stage);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, stage);
+    return true;
+  }
+
+  if (!strcmp("avg", stat))
+    cdbus_reply_int32(ps, msg, frame_timing_avg(ps->timing, s));
+  else if (!strcmp("max", stat))
+    cdbus_reply_int32(ps, msg, frame_timing_max(ps->timing, s));
+  else if (!strcmp("last", stat))
+    cdbus_reply_int32(ps, msg, frame_timing_last(ps->timing, s));
+  else {
+    log_error(CDBUS_ERROR_BADTGT_S, stat);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, stat);
+  }
+  return true;
+}
+
+/**
+ * Process a trace D-Bus request.
+ */
+static bool
+cdbus_process_trace(session_t *ps, DBusMessage *msg) {
+  bool val = false;
+
+  if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_BOOLEAN, &val))
+    return false;
+
+  bool ret = set_tracing(ps, val);
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, ret);
+  return true;
+}
+
+/**
+ * Process a resources_get D-Bus request.
+ */
+static bool
+cdbus_process_resources_get(session_t *ps, DBusMessage *msg) {
+  char *report = render_resource_report(ps);
+  cdbus_reply_string(ps, msg, report ? report : "");
+  free(report);
+  return true;
+}
+
+/**
+ * Process a histogram_get D-Bus request.
+ */
+static bool
+cdbus_process_histogram_get(session_t *ps, DBusMessage *msg) {
+  char *report = frame_timing_histogram_report(ps->timing);
+  cdbus_reply_string(ps, msg, report ? report : "");
+  free(report);
+  return true;
+}
+
+/**
+ * Process a round_trips_get D-Bus request.
+ */
+static bool
+cdbus_process_round_trips_get(session_t *ps, DBusMessage *msg) {
+  char *report = round_trip_report(ps, ev_type_name);
+  cdbus_reply_string(ps, msg, report ? report : "");
+  free(report);
+  return true;
+}
+
+/**
+ * Process a stats_get D-Bus request.
+ */
+static bool
+cdbus_process_stats_get(session_t *ps, DBusMessage *msg) {
+  const char *target = NULL;
+
+  if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_STRING, &target))
+    return false;
+
+#define cdbus_m_stats_get_do(tgt, apdarg_func, ret) \
+  if (!strcmp(tgt, target)) { \
+    apdarg_func(ps, msg, ret); \
+    return true; \
+  }
+
+  // Painting resources
+  cdbus_m_stats_get_do("resource_kib", cdbus_reply_uint32,
+      render_resource_bytes(ps) / 1024);
+  cdbus_m_stats_get_do("releases", cdbus_reply_uint32, ps->releases);
+  cdbus_m_stats_get_do("release_before_kib", cdbus_reply_uint32,
+      ps->release_before / 1024);
+  cdbus_m_stats_get_do("release_after_kib", cdbus_reply_uint32,
+      ps->release_after / 1024);
+  cdbus_m_stats_get_do("evictions", cdbus_reply_uint32, ps->evictions);
+  cdbus_m_stats_get_do("evicted_kib", cdbus_reply_uint32, ps->evicted / 1024);
+  if (!strncmp("resource_", target, 9)) {
+    size_t bytes[NUM_RENDER_RES];
+    render_resource_usage(ps, bytes);
+    for (int i = 0; i < NUM_RENDER_RES; i++) {
+      char key[32];
+      snprintf(key, sizeof(key), "resource_%s_kib", RENDER_RES_NAMES[i]);
+      cdbus_m_stats_get_do(key, cdbus_reply_uint32, bytes[i] / 1024);
+    }
+  }
+
+  // Event processing
+  cdbus_m_stats_get_do("events_handled", cdbus_reply_uint32, ps->events_handled);
+  cdbus_m_stats_get_do("events_deferred", cdbus_reply_uint32, ps->events_deferred);
+  cdbus_m_stats_get_do("events_coalesced", cdbus_reply_uint32,
+      ps->events_coalesced);
+  cdbus_m_stats_get_do("event_backlog", cdbus_reply_uint32,
+      ps->ndeferred_events);
+  cdbus_m_stats_get_do("event_backlog_max", cdbus_reply_uint32,
+      ps->event_backlog_max);
+  cdbus_m_stats_get_do("event_budget_overruns", cdbus_reply_uint32,
+      ps->event_budget_overruns);
+
+  // Round trips to the X server
+  cdbus_m_stats_get_do("round_trips", cdbus_reply_uint32, round_trips.count);
+  cdbus_m_stats_get_do("round_trip_us", cdbus_reply_uint32,
+      round_trips.total_us);
+  cdbus_m_stats_get_do("round_trips_frames", cdbus_reply_uint32,
+      round_trips.frame_count);
+  cdbus_m_stats_get_do("round_trips_last_frame", cdbus_reply_uint32,
+      round_trips.frame_last);
+  cdbus_m_stats_get_do("round_trips_max_frame", cdbus_reply_uint32,
+      round_trips.frame_max);
+
+  // Damage-to-photon latency
+  cdbus_m_stats_get_do("latency_frames", cdbus_reply_uint32,
+      ps->latency->frames);
+  cdbus_m_stats_get_do("latency_p50_us", cdbus_reply_int32,
+      latency_percentile(ps->latency, 50));
+  cdbus_m_stats_get_do("latency_p95_us", cdbus_reply_int32,
+      latency_percentile(ps->latency, 95));
+  cdbus_m_stats_get_do("latency_p99_us", cdbus_reply_int32,
+      latency_percentile(ps->latency, 99));
+
+  // Frames shown late
+  cdbus_m_stats_get_do("vblank_missed_frames", cdbus_reply_uint32,
+      ps->timing->missed);
+  cdbus_m_stats_get_do("vblanks_missed", cdbus_reply_uint32,
+      ps->timing->missed_vblanks);
+
+  // Frame pacing
+  const struct frame_pacing *p = ps->pacing;
+  if (p) {
+    cdbus_m_stats_get_do("frame_predicted_us", cdbus_reply_int32, p->predicted);
+    cdbus_m_stats_get_do("frame_actual_us", cdbus_reply_int32, p->actual);
+    cdbus_m_stats_get_do("frame_preprocess_us", cdbus_reply_int32,
+        pacing_last_stage_time(p, PACING_STAGE_PREPROCESS));
+    cdbus_m_stats_get_do("frame_render_us", cdbus_reply_int32,
+        pacing_last_stage_time(p, PACING_STAGE_RENDER));
+    cdbus_m_stats_get_do("frame_present_us", cdbus_reply_int32,
+        pacing_last_stage_time(p, PACING_STAGE_PRESENT));
+    cdbus_m_stats_get_do("frames", cdbus_reply_uint32, p->frames);
+    cdbus_m_stats_get_do("frames_missed", cdbus_reply_uint32, p->missed);
+    cdbus_m_stats_get_do("refresh_interval_us", cdbus_reply_int32,
+        p->refresh_intv);
+  }
+#undef cdbus_m_stats_get_do
+
+  log_error(CDBUS_ERROR_BADTGT_S, target);
+  cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+
+  return true;
+}
+
 // XXX Remove this after header clean up
 void queue_redraw(session_t *ps);
 
@@ -1242,6 +1477,8 @@ cdbus_process_opts_set(session_t *ps, DBusMessage *msg) {
   return true;
 
 cdbus_process_opts_set_success:
+  // Options can change how any window is painted
+  ps->preprocess_all = true;
   if (!dbus_message_get_no_reply(msg))
     cdbus_reply_bool(ps, msg, true);
   return true;
@@ -1304,6 +1541,7 @@ static DBusHandlerResult
 cdbus_process(DBusConnection *c, DBusMessage *msg, void *ud) {
   session_t *ps = ud;
   bool handled = false;
+  long span = trace_begin(ps->trace);
 
 #define cdbus_m_ismethod(method) \
   dbus_message_is_method_call(msg, CDBUS_INTERFACE_NAME, method)
@@ -1338,6 +1576,24 @@ cdbus_process(DBusConnection *c, DBusMessage *msg, void *ud) {
   else if (cdbus_m_ismethod("opts_set")) {
     handled = cdbus_process_opts_set(ps, msg);
   }
+  else if (cdbus_m_ismethod("stats_get")) {
+    handled = cdbus_process_stats_get(ps, msg);
+  }
+  else if (cdbus_m_ismethod("timing_get")) {
+    handled = cdbus_process_timing_get(ps, msg);
+  }
+  else if (cdbus_m_ismethod("trace")) {
+    handled = cdbus_process_trace(ps, msg);
+  }
+  else if (cdbus_m_ismethod("round_trips_get")) {
+    handled = cdbus_process_round_trips_get(ps, msg);
+  }
+  else if (cdbus_m_ismethod("resources_get")) {
+    handled = cdbus_process_resources_get(ps, msg);
+  }
+  else if (cdbus_m_ismethod("histogram_get")) {
+    handled = cdbus_process_histogram_get(ps, msg);
+  }
 #undef cdbus_m_ismethod
   else if (dbus_message_is_method_call(msg,
         "org.freedesktop.DBus.Introspectable", "Introspect")) {
@@ -1388,6 +1644,7 @@ cdbus_process(DBusConnection *c, DBusMessage *msg, void *ud) {
     handled = true;
   }
 
+  trace_end(ps->trace, span, "dbus", "dbus", dbus_message_get_member(msg), 0);
   return handled ? DBUS_HANDLER_RESULT_HANDLED : DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
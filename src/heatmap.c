@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <string.h>
+
+#include "utils.h"
+
+#include "heatmap.h"
+
+void heatmap_resize(struct heatmap *h, int width, int height) {
+	width = (width + HEATMAP_CELL - 1) / HEATMAP_CELL;
+	height = (height + HEATMAP_CELL - 1) / HEATMAP_CELL;
+	if (h->cells && h->width == width && h->height == height)
+		return;
+	free(h->cells);
+	h->width = width;
+	h->height = height;
+	h->cells = ccalloc(width * height, uint8_t);
+	h->hot = false;
+}
+
+void heatmap_damage(struct heatmap *h, const region_t *damage) {
+	if (!h->cells)
+		return;
+	int nrects;
+	const rect_t *rects = pixman_region32_rectangles((region_t *)damage, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		int x1 = max_i(rects[i].x1 / HEATMAP_CELL, 0);
+		int y1 = max_i(rects[i].y1 / HEATMAP_CELL, 0);
+		int x2 = min_i((rects[i].x2 + HEATMAP_CELL - 1) / HEATMAP_CELL, h->width);
+		int y2 = min_i((rects[i].y2 + HEATMAP_CELL - 1) / HEATMAP_CELL, h->height);
+		for (int y = y1; y < y2; y++) {
+			uint8_t *row = h->cells + y * h->width;
+			for (int x = x1; x < x2; x++)
+				row[x] = (uint8_t)min_i(row[x] + HEATMAP_STEP, HEATMAP_MAX);
+		}
+		if (!h->hot && x1 < x2 && y1 < y2) {
+			// Start cooling down from the next call
+			h->hot = true;
+			h->last_cool = 0;
+		}
+	}
+}
+
+void heatmap_cool(struct heatmap *h, long now) {
+	if (!h->hot || !h->last_cool) {
+		h->last_cool = now;
+		return;
+	}
+	long amount = (now - h->last_cool) * HEATMAP_MAX / HEATMAP_COOL_US;
+	// Leave the time that is too short to cool anything for the next call
+	if (amount < 1)
+		return;
+	h->last_cool = now;
+
+	amount = min_l(amount, HEATMAP_MAX);
+	h->hot = false;
+	for (int i = 0; i < h->width * h->height; i++) {
+		h->cells[i] = (uint8_t)max_l(h->cells[i] - amount, 0);
+		h->hot = h->hot || h->cells[i];
+	}
+}
+
+/// Whether a cell of the given heat is painted at `level`.
+static inline bool heatmap_at_level(uint8_t heat, int level) {
+	return heat && (level < 0 || heat * HEATMAP_NLEVELS / (HEATMAP_MAX + 1) == level);
+}
+
+void heatmap_region(const struct heatmap *h, int level, region_t *res) {
+	pixman_region32_clear(res);
+	if (!h->hot)
+		return;
+
+	// Cells in a row are merged into one rectangle, pixman merges the rows
+	auto boxes = ccalloc(h->width * h->height, rect_t);
+	int nboxes = 0;
+	for (int y = 0; y < h->height; y++) {
+		const uint8_t *row = h->cells + y * h->width;
+		for (int x = 0; x < h->width;) {
+			if (!heatmap_at_level(row[x], level)) {
+				x++;
+				continue;
+			}
+			int start = x;
+			while (++x < h->width && heatmap_at_level(row[x], level))
+				;
+			boxes[nboxes++] = (rect_t){.x1 = start * HEATMAP_CELL,
+			                           .y1 = y * HEATMAP_CELL,
+			                           .x2 = x * HEATMAP_CELL,
+			                           .y2 = (y + 1) * HEATMAP_CELL};
+		}
+	}
+	pixman_region32_fini(res);
+	pixman_region32_init_rects(res, boxes, nboxes);
+	free(boxes);
+}
+
+void heatmap_free(struct heatmap *h) {
+	if (h)
+		free(h->cells);
+	free(h);
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "region.h"
+
+/// A heat map of client damage, painted over the screen by --monitor-repaint.
+///
+/// The screen is divided into square cells. Damage heats up the cells it
+/// touches, and they cool down over time, so areas damaged often stay hot
+/// while the rest fades out.
+
+/// Size of a cell, in pixels.
+#define HEATMAP_CELL 16
+
+/// Hottest a cell can be.
+#define HEATMAP_MAX 255
+
+/// Heat added to the cells touched by a damage.
+#define HEATMAP_STEP 64
+
+/// Time a cell at HEATMAP_MAX takes to cool down, in microseconds.
+#define HEATMAP_COOL_US 1000000L
+
+/// Interval between frames painted while the map cools down, in microseconds.
+#define HEATMAP_REPAINT_US 33333L
+
+/// Number of colors the heat is painted with.
+#define HEATMAP_NLEVELS 4
+
+struct heatmap {
+	/// Size of the map, in cells.
+	int width, height;
+	uint8_t *cells;
+	/// Whether any cell is hot.
+	bool hot;
+	/// When the cells were last cooled down.
+	long last_cool;
+};
+
+/// Resize the map to cover a screen of the given size, in pixels. The cells
+/// are cleared if the size changes.
+void heatmap_resize(struct heatmap *, int width, int height);
+
+/// Heat up the cells touched by `damage`.
+void heatmap_damage(struct heatmap *, const region_t *damage);
+
+/// Cool the cells down by the time passed since the last call, or since the
+/// first call after they heated up.
+void heatmap_cool(struct heatmap *, long now);
+
+/// Get the area covered by the cells at `level`, from 0 to HEATMAP_NLEVELS -
+/// 1, or by all hot cells if `level` is -1.
+void heatmap_region(const struct heatmap *, int level, region_t *res);
+
+void heatmap_free(struct heatmap *);
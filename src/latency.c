@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "utils.h"
+
+#include "latency.h"
+
+void latency_frame_painted(struct latency_stats *l, long oldest_damage) {
+	l->pending = oldest_damage;
+}
+
+static int latency_cmp(const void *a, const void *b) {
+	long x = *(const long *)a, y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+long latency_percentile(const struct latency_stats *l, int p) {
+	if (!l->nsamples)
+		return 0;
+	long sorted[LATENCY_NSAMPLES];
+	memcpy(sorted, l->samples, l->nsamples * sizeof(long));
+	qsort(sorted, l->nsamples, sizeof(long), latency_cmp);
+	// Nearest rank
+	int rank = (p * l->nsamples + 99) / 100;
+	return sorted[max_i(min_i(rank, l->nsamples), 1) - 1];
+}
+
+void latency_frame_shown(struct latency_stats *l, long when) {
+	if (!l->pending)
+		return;
+	l->samples[l->next_sample] = max_l(when - l->pending, 0);
+	l->next_sample = (l->next_sample + 1) % LATENCY_NSAMPLES;
+	l->nsamples = min_i(l->nsamples + 1, LATENCY_NSAMPLES);
+	l->frames++;
+	l->pending = 0;
+
+	if (when - l->last_log >= LATENCY_LOG_INTERVAL_US) {
+		l->last_log = when;
+		log_debug("Damage-to-photon latency over %d frames: p50 %ld us, p95 "
+		          "%ld us, p99 %ld us",
+		          l->nsamples, latency_percentile(l, 50),
+		          latency_percentile(l, 95), latency_percentile(l, 99));
+	}
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+
+/// Damage-to-photon latency, i.e. the time from a DamageNotify coming in to
+/// the frame with that damage being shown.
+///
+/// Each frame records the oldest client damage it includes. When the frame is
+/// shown, its latency is added to a window of recent samples, which
+/// percentiles are computed from.
+
+/// Number of recent frames percentiles are computed from.
+#define LATENCY_NSAMPLES 256
+
+/// Interval between percentiles logged at debug level, in microseconds.
+#define LATENCY_LOG_INTERVAL_US 10000000L
+
+struct latency_stats {
+	/// Latency of recent frames, in microseconds.
+	long samples[LATENCY_NSAMPLES];
+	/// Number of valid samples.
+	int nsamples;
+	/// Where the next sample is stored.
+	int next_sample;
+	/// Number of frames with client damage shown.
+	unsigned long frames;
+	/// Oldest client damage in the frame painted but not shown yet, 0 if
+	/// none.
+	long pending;
+	/// When the percentiles were last logged.
+	long last_log;
+};
+
+/// Record that a frame is painted, including client damage that came in at
+/// `oldest_damage`, or none if 0.
+void latency_frame_painted(struct latency_stats *, long oldest_damage);
+
+/// Record that the frame painted last is shown at `when`.
+void latency_frame_shown(struct latency_stats *, long when);
+
+/// Latency under which `p` percent of the recent frames are, in microseconds.
+/// 0 if no frame is recorded.
+long latency_percentile(const struct latency_stats *, int p);
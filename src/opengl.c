@@ -36,6 +36,9 @@ get_visualinfo_from_visual(session_t *ps, xcb_visualid_t visual) {
   return XGetVisualInfo(ps->dpy, VisualIDMask, &vreq, &nitems);
 }
 
+static void
+glx_probe_tfp(session_t *ps);
+
 /**
  * Initialize OpenGL.
  */
@@ -195,6 +198,9 @@ glx_init(session_t *ps, bool need_render) {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // glXSwapBuffers(ps->dpy, get_tgt_window(ps));
+
+    // Before anything is painted, not to stall a frame
+    glx_probe_tfp(ps);
   }
 
   success = true;
@@ -242,6 +248,9 @@ glx_destroy(session_t *ps) {
       glDeleteProgram(ppass->prog);
   }
 
+  gl_kawase_blur_free(ps->psglx->kawase_blur);
+  ps->psglx->kawase_blur = NULL;
+
   glx_free_prog_main(ps, &ps->glx_prog_win);
 
   gl_check_err();
@@ -298,6 +307,17 @@ glx_on_root_change(session_t *ps) {
  */
 bool
 glx_init_blur(session_t *ps) {
+  if (ps->o.blur_method == BLUR_METHOD_DUAL_KAWASE) {
+    // The downscaled levels are not power-of-two sized
+    if (!ps->psglx->has_texture_non_power_of_two) {
+      log_error("Dual-Kawase blur requires GL_ARB_texture_non_power_of_two.");
+      return false;
+    }
+    ps->psglx->kawase_blur =
+      gl_kawase_blur_new(ps->o.blur_iterations, ps->o.blur_strength);
+    return ps->psglx->kawase_blur;
+  }
+
   assert(ps->o.blur_kerns[0]);
 
   // Allocate PBO if more than one blur kernel is present
@@ -396,19 +416,14 @@ glx_init_blur(session_t *ps) {
 
         sprintf(pc, FRAG_SHADER_BLUR_SUFFIX, texture_func, sum);
         assert(strlen(shader_str) < len);
-        ppass->frag_shader = gl_create_shader(GL_FRAGMENT_SHADER, shader_str);
-        free(shader_str);
-      }
 
-      if (!ppass->frag_shader) {
-        log_error("Failed to create fragment shader %d.", i);
-        free(extension);
-        free(lc_numeric_old);
-        return false;
+        // Build program. It might come from the program cache, in which case
+        // there is no fragment shader object, so we never keep one.
+        ppass->frag_shader = 0;
+        ppass->prog = gl_create_program_from_str(NULL, shader_str);
+        free(shader_str);
       }
 
-      // Build program
-      ppass->prog = gl_create_program(&ppass->frag_shader, 1);
       if (!ppass->prog) {
         log_error("Failed to create GLSL program.");
         free(extension);
@@ -626,6 +641,137 @@ glx_bind_pixmap(session_t *ps, glx_texture_t **pptex, xcb_pixmap_t pixmap,
   return true;
 }
 
+/**
+ * Check whether every texel of a texture has the given value in its red
+ * component.
+ */
+static inline bool
+glx_texture_is(const glx_texture_t *ptex, GLubyte red) {
+  GLubyte buf[ptex->width * ptex->height * 4];
+  glBindTexture(ptex->target, ptex->texture);
+  glGetTexImage(ptex->target, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+  glBindTexture(ptex->target, 0);
+  for (size_t i = 0; i < sizeof(buf); i += 4)
+    if (buf[i] != red)
+      return false;
+  return true;
+}
+
+/**
+ * Check whether a texture bound to a pixmap of the given depth follows later
+ * changes to the pixmap without being rebound.
+ *
+ * GLX_EXT_texture_from_pixmap leaves the content of a bound texture undefined
+ * after the pixmap changes, but many drivers share storage between the pixmap
+ * and the texture, in which case rebinding is pure overhead. We bind a small
+ * pixmap, and change it from black to white and back, reading the whole
+ * texture back each time. This can only show that a driver doesn't follow the
+ * changes, so its result is a heuristic.
+ */
+static bool
+glx_probe_tfp_live(session_t *ps, struct glx_fbconfig_criteria m) {
+  const unsigned size = 4;
+  const uint32_t black = 0;
+  const uint32_t white =
+    (m.visual_depth >= 32 ? UINT32_MAX: (1u << m.visual_depth) - 1);
+  glx_texture_t *ptex = NULL;
+  bool live = false;
+
+  struct glx_fbconfig_info *fbcfg = glx_find_fbconfig(ps->dpy, ps->scr, m);
+  if (!fbcfg)
+    return false;
+
+  xcb_pixmap_t pixmap = x_create_pixmap(ps->c, (uint8_t)m.visual_depth,
+      ps->root, size, size);
+  if (!pixmap) {
+    free(fbcfg);
+    return false;
+  }
+
+  xcb_gcontext_t gc = xcb_generate_id(ps->c);
+  xcb_rectangle_t rect = { .x = 0, .y = 0, .width = size, .height = size };
+  xcb_create_gc(ps->c, gc, pixmap, XCB_GC_FOREGROUND, &black);
+  xcb_poly_fill_rectangle(ps->c, pixmap, gc, 1, &rect);
+  x_sync(ps->c);
+
+  if (!glx_bind_pixmap(ps, &ptex, pixmap, size, size, false, fbcfg))
+    goto end;
+  // If the texture doesn't start black, we can't tell anything
+  if (!glx_texture_is(ptex, 0))
+    goto end;
+
+  live = true;
+  const uint32_t colors[] = { white, black };
+  for (size_t i = 0; i < ARR_SIZE(colors) && live; i++) {
+    xcb_change_gc(ps->c, gc, XCB_GC_FOREGROUND, &colors[i]);
+    xcb_poly_fill_rectangle(ps->c, pixmap, gc, 1, &rect);
+    x_sync(ps->c);
+    glXWaitX();
+    live = glx_texture_is(ptex, colors[i] ? 0xff: 0);
+  }
+
+end:
+  free_texture(ps, &ptex);
+  xcb_free_gc(ps->c, gc);
+  xcb_free_pixmap(ps->c, pixmap);
+  free(fbcfg);
+  gl_check_err();
+  return live;
+}
+
+/**
+ * Decide whether bound textures have to be rebound to see new content of
+ * their pixmaps, unless the user decided for us.
+ *
+ * Depths of the root visual, and of the usual RGB and ARGB window visuals, are
+ * probed. Rebinds are only skipped if all of them pass, and only for those
+ * depths.
+ */
+static void
+glx_probe_tfp(session_t *ps) {
+  ps->psglx->tfp_live_depths = 0;
+  if (ps->o.glx_no_rebind_pixmap || ps->o.glx_force_rebind_pixmap)
+    return;
+
+  const struct glx_fbconfig_criteria criteria[] = {
+    x_visual_to_fbconfig_criteria(ps->c, ps->vis),
+    { .red_size = 8, .green_size = 8, .blue_size = 8, .alpha_size = 0,
+      .visual_depth = 24 },
+    { .red_size = 8, .green_size = 8, .blue_size = 8, .alpha_size = 8,
+      .visual_depth = 32 },
+  };
+  uint64_t depths = 0;
+  for (size_t i = 0; i < ARR_SIZE(criteria); i++) {
+    int depth = criteria[i].visual_depth;
+    if (depth <= 0 || depth > OPENGL_MAX_DEPTH || (depths & (1ull << depth)))
+      continue;
+    if (!glx_probe_tfp_live(ps, criteria[i])) {
+      log_info("Texture from pixmap with depth %d is not updated in place, "
+          "rebinding on damage.", depth);
+      return;
+    }
+    depths |= 1ull << depth;
+  }
+
+  log_info("Texture from pixmap is updated in place, skipping rebinds on "
+      "damage. Use --glx-force-rebind-pixmap if window contents stop "
+      "updating.");
+  ps->psglx->tfp_live_depths = depths;
+}
+
+/**
+ * Check whether a bound texture has to be rebound to see new content of its
+ * pixmap.
+ */
+bool
+glx_tfp_need_rebind(session_t *ps, int depth) {
+  if (ps->o.glx_no_rebind_pixmap)
+    return false;
+  if (depth <= 0 || depth > OPENGL_MAX_DEPTH)
+    return true;
+  return !(ps->psglx->tfp_live_depths & (1ull << depth));
+}
+
 /**
  * @brief Release binding of a texture.
  */
@@ -728,6 +874,16 @@ glx_blur_dst(session_t *ps, int dx, int dy, int width, int height, float z,
     GLfloat factor_center,
     const region_t *reg_tgt,
     glx_blur_cache_t *pbc) {
+  if (ps->psglx->kawase_blur) {
+    // The kernel path weights the center pixel with factor_center against
+    // 8 neighbours of weight 1. Mixing the blur into the original by the
+    // same share gives the dual-Kawase path the same opacity dependent
+    // strength, and full strength with --blur-background-fixed.
+    const GLfloat opacity = normalize_d(9.0 / (factor_center + 8.0));
+    return gl_kawase_blur_dst(ps->psglx->kawase_blur, ps->root_width,
+        ps->root_height, dx, dy, width, height, z, opacity, reg_tgt);
+  }
+
   assert(ps->psglx->blur_passes[0].prog);
   const bool more_passes = ps->psglx->blur_passes[1].prog;
   const bool have_scissors = glIsEnabled(GL_SCISSOR_TEST);
@@ -960,6 +1116,42 @@ glx_dim_dst(session_t *ps, int dx, int dy, int width, int height, float z,
   return true;
 }
 
+/**
+ * Blend a color over a region of the screen.
+ */
+bool
+glx_fill_dst(session_t *ps, const region_t *reg_tgt, float z,
+    GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  const int dx = 0, dy = 0, width = ps->root_width, height = ps->root_height;
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  // Premultiply color
+  glColor4f(red * alpha, green * alpha, blue * alpha, alpha);
+
+  {
+    P_PAINTREG_START(crect) {
+      GLint rdx = crect.x1;
+      GLint rdy = ps->root_height - crect.y1;
+      GLint rdxe = rdx + (crect.x2 - crect.x1);
+      GLint rdye = rdy - (crect.y2 - crect.y1);
+
+      glVertex3i(rdx, rdy, z);
+      glVertex3i(rdxe, rdy, z);
+      glVertex3i(rdxe, rdye, z);
+      glVertex3i(rdx, rdye, z);
+    }
+    P_PAINTREG_END();
+  }
+
+  glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+  glDisable(GL_BLEND);
+
+  gl_check_err();
+
+  return true;
+}
+
 /**
  * @brief Render a region with texture data.
  */
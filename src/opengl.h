@@ -30,6 +30,10 @@ bool
 glx_dim_dst(session_t *ps, int dx, int dy, int width, int height, float z,
     GLfloat factor, const region_t *reg_tgt);
 
+bool
+glx_fill_dst(session_t *ps, const region_t *reg_tgt, float z,
+    GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
 bool
 glx_render(session_t *ps, const glx_texture_t *ptex,
     int x, int y, int dx, int dy, int width, int height, int z,
@@ -66,6 +70,9 @@ glx_bind_pixmap(session_t *ps, glx_texture_t **pptex, xcb_pixmap_t pixmap,
 void
 glx_release_pixmap(session_t *ps, glx_texture_t *ptex);
 
+bool
+glx_tfp_need_rebind(session_t *ps, int depth);
+
 void glx_paint_pre(session_t *ps, region_t *preg)
 attr_nonnull(1, 2);
 
@@ -51,7 +51,8 @@ static void usage(int ret) {
 	    "  Opacity change between steps while fading out. (default 0.03)\n"
 	    "\n"
 	    "-D fade-delta-time\n"
-	    "  The time between steps in a fade in milliseconds. (default 10)\n"
+	    "  The time between steps in a fade in milliseconds. Fading windows\n"
+	    "  are repainted at most this often. (default 10)\n"
 	    "\n"
 	    "-m opacity\n"
 	    "  The opacity for menus. (default 1.0)\n"
@@ -127,6 +128,10 @@ static void usage(int ret) {
 	    "--fade-exclude condition\n"
 	    "  Exclude conditions for fading.\n"
 	    "\n"
+	    "--fade-easing curve\n"
+	    "  Easing curve of fading: linear, ease-in, ease-out or ease-in-out.\n"
+	    "  (default linear)\n"
+	    "\n"
 	    "--mark-ovredir-focused\n"
 	    "  Mark windows that have no WM frame as active.\n"
 	    "\n"
@@ -159,7 +164,7 @@ static void usage(int ret) {
 	    "  will try detecting this with X RandR extension.\n"
 	    "\n"
 	    "--vsync vsync-method\n"
-	    "  Set VSync method. There are (up to) 5 VSync methods currently\n"
+	    "  Set VSync method. There are (up to) 7 VSync methods currently\n"
 	    "  available:\n"
 	    "    none = No VSync\n"
 #undef WARNING
@@ -177,12 +182,22 @@ static void usage(int ret) {
 #define WARNING
 #endif
 	    "    opengl = Try to VSync with SGI_video_sync OpenGL extension. Only\n"
-	    "      work on some drivers." WARNING "\n"
+	    "      work on some drivers. Waits on a separate thread." WARNING "\n"
 	    "    opengl-oml = Try to VSync with OML_sync_control OpenGL extension.\n"
-	    "      Only work on some drivers." WARNING "\n"
+	    "      Only work on some drivers. Waits on a separate thread." WARNING "\n"
 	    "    opengl-swc = Enable driver-level VSync. Works only with GLX "
 	    "backend." WARNING "\n"
 	    "    opengl-mswc = Deprecated, use opengl-swc instead." WARNING "\n"
+	    "    present = Present frames with the X Present extension. Works\n"
+	    "      only with xrender backend, and does not block while waiting.\n"
+#undef WARNING
+#ifndef CONFIG_VSYNC_DRM
+#define WARNING WARNING_DISABLED
+#else
+#define WARNING
+#endif
+	    "    drm-event = Like drm, but shows the frame from a vblank event\n"
+	    "      instead of blocking until the vblank." WARNING "\n"
 	    "\n"
 	    "--vsync-aggressive\n"
 	    "  Attempt to send painting request before VBlank and do XFlush()\n"
@@ -195,6 +210,11 @@ static void usage(int ret) {
 	    "  Limit compton to repaint at most once every 1 / refresh_rate\n"
 	    "  second to boost performance.\n"
 	    "\n"
+	    "--frame-pacing\n"
+	    "  Start each frame just early enough to be ready for the next\n"
+	    "  VBlank, based on the render time of recent frames. Replaces\n"
+	    "  --sw-opti.\n"
+	    "\n"
 	    "--use-ewmh-active-win\n"
 	    "  Use _NET_WM_ACTIVE_WINDOW on the root window to determine which\n"
 	    "  window is focused instead of using FocusIn/Out events.\n"
@@ -211,6 +231,32 @@ static void usage(int ret) {
 	    "  Delay before unredirecting the window, in milliseconds.\n"
 	    "  Defaults to 0.\n"
 	    "\n"
+	    "--event-budget ms\n"
+	    "  Handle X events for at most this many milliseconds at a time, and\n"
+	    "  handle map, unmap, configure and destroy events before damage and\n"
+	    "  property changes, so floods of events don't hold back frames.\n"
+	    "  Defaults to 0, which handles all queued events in order.\n"
+	    "\n"
+	    "--timing-log-interval seconds\n"
+	    "  Log the average and longest time spent in each stage of recent\n"
+	    "  frames this often. Defaults to 0, which logs nothing.\n"
+	    "\n"
+	    "--trace-file path\n"
+	    "  Write Chrome trace events of event handling, painting and D-Bus\n"
+	    "  calls to this file while tracing is on. Tracing is turned on and\n"
+	    "  off by SIGUSR2 and the D-Bus method trace.\n"
+	    "\n"
+	    "--release-resources-delay ms\n"
+	    "  Free pictures, textures, shadows and blur caches after this many\n"
+	    "  milliseconds without damage. They are rebuilt when painting\n"
+	    "  resumes. Defaults to 0, which only frees them when the screen is\n"
+	    "  unredirected.\n"
+	    "\n"
+	    "--resource-budget MiB\n"
+	    "  When the painting resources held go over this size, free the\n"
+	    "  largest that can be rebuilt, starting with those of windows not\n"
+	    "  being painted. Defaults to 0, which sets no limit.\n"
+	    "\n"
 	    "--unredir-if-possible-exclude condition\n"
 	    "  Conditions of windows that shouldn't be considered full-screen\n"
 	    "  for unredirecting screen.\n"
@@ -269,6 +315,20 @@ static void usage(int ret) {
 	    "--blur-background-exclude condition\n"
 	    "  Exclude conditions for background blur.\n"
 	    "\n"
+	    "--blur-method method\n"
+	    "  Blur algorithm to use: kernel (default) runs the --blur-kern\n"
+	    "  kernels, dual_kawase blurs through a chain of downscaled\n"
+	    "  textures and stays fast with a large blur radius. dual_kawase\n"
+	    "  needs the glx backend.\n"
+	    "\n"
+	    "--blur-strength float\n"
+	    "  dual_kawase: distance between samples, in pixels of each\n"
+	    "  downscaled level. (default 1.5)\n"
+	    "\n"
+	    "--blur-iterations integer\n"
+	    "  dual_kawase: number of times the image is halved. Each step\n"
+	    "  roughly doubles the blur radius. (1-8, default 3)\n"
+	    "\n"
 	    "--resize-damage integer\n"
 	    "  Resize damaged region by a specific number of pixels. A positive\n"
 	    "  value enlarges it while a negative one shrinks it. Useful for\n"
@@ -286,6 +346,11 @@ static void usage(int ret) {
 	    "  any guarantee about possible conflicts with other programs that set\n"
 	    "  _NET_WM_WINDOW_OPACITY on frame or client windows.\n"
 	    "\n"
+	    "--damage-rate-rule rate:condition\n"
+	    "  Specify a list of damage rate rules, in the format \"HZ:PATTERN\",\n"
+	    "  like '30:!focused'. Damage of matching windows is repaired at most\n"
+	    "  HZ times per second.\n"
+	    "\n"
 	    "--shadow-exclude-reg geometry\n"
 	    "  Specify a X geometry that describes the region in which shadow\n"
 	    "  should not be painted in, such as a dock window region.\n"
@@ -321,7 +386,16 @@ static void usage(int ret) {
 	    "  GLX backend: Avoid rebinding pixmap on window damage. Probably\n"
 	    "  could improve performance on rapid window content changes, but is\n"
 	    "  known to break things on some drivers (LLVMpipe, xf86-video-intel,\n"
-	    "  etc.).\n"
+	    "  etc.). By default, compton tests whether the driver needs the\n"
+	    "  rebind.\n"
+	    "\n"
+	    "--glx-force-rebind-pixmap\n"
+	    "  GLX backend: Always rebind pixmap on window damage, instead of\n"
+	    "  testing whether the driver needs it.\n"
+	    "\n"
+	    "--glx-no-program-cache\n"
+	    "  GLX backend: Don't cache compiled GLSL programs in\n"
+	    "  $XDG_CACHE_HOME/compton/programs.\n"
 	    "\n"
 	    "--glx-swap-method undefined/copy/exchange/3/4/5/6/buffer-age\n"
 	    "  GLX backend: GLX buffer swap method we assume. Could be\n"
@@ -365,9 +439,18 @@ static void usage(int ret) {
 	    "--benchmark-wid window-id\n"
 	    "  Specify window ID to repaint in benchmark mode. If omitted or is 0,\n"
 	    "  the whole screen is repainted.\n"
+	    "\n"
+	    "--record-events path\n"
+	    "  Record the X events compton handles, and the replies it waits for\n"
+	    "  while handling them, to this file.\n"
+	    "\n"
+	    "--replay-events path\n"
+	    "  Handle the events recorded in this file as fast as possible, log\n"
+	    "  how long it took, and exit. Nothing is painted.\n"
+	    "\n"
 	    "--monitor-repaint\n"
-	    "  Highlight the updated area of the screen. For debugging the xrender\n"
-	    "  backend only.\n";
+	    "  Paint a heat map of the areas of the screen damaged by clients,\n"
+	    "  which fades out over a second. For debugging.\n";
 	FILE *f = (ret ? stderr : stdout);
 	fputs(usage_text, f);
 #undef WARNING
@@ -460,6 +543,21 @@ static const struct option longopts[] = {
     {"no-name-pixmap", no_argument, NULL, 320},
     {"log-level", required_argument, NULL, 321},
     {"log-file", required_argument, NULL, 322},
+    {"glx-no-program-cache", no_argument, NULL, 323},
+    {"glx-force-rebind-pixmap", no_argument, NULL, 324},
+    {"blur-method", required_argument, NULL, 325},
+    {"blur-strength", required_argument, NULL, 326},
+    {"blur-iterations", required_argument, NULL, 327},
+    {"frame-pacing", no_argument, NULL, 328},
+    {"fade-easing", required_argument, NULL, 329},
+    {"damage-rate-rule", required_argument, NULL, 330},
+    {"release-resources-delay", required_argument, NULL, 331},
+    {"event-budget", required_argument, NULL, 332},
+    {"timing-log-interval", required_argument, NULL, 333},
+    {"trace-file", required_argument, NULL, 334},
+    {"record-events", required_argument, NULL, 335},
+    {"replay-events", required_argument, NULL, 336},
+    {"resource-budget", required_argument, NULL, 337},
     {"reredir-on-root-change", no_argument, NULL, 731},
     {"glx-reinit-on-root-change", no_argument, NULL, 732},
     {"monitor-repaint", no_argument, NULL, 800},
@@ -790,6 +888,50 @@ void get_cfg(options_t *opt, int argc, char *const *argv, bool shadow_enable,
 			break;
 		}
 		P_CASEBOOL(319, no_x_selection);
+		P_CASEBOOL(323, glx_no_program_cache);
+		P_CASEBOOL(324, glx_force_rebind_pixmap);
+		case 325:
+			// --blur-method
+			opt->blur_method = parse_blur_method(optarg);
+			if (opt->blur_method >= NUM_BLUR_METHOD)
+				exit(1);
+			break;
+		case 326:
+			// --blur-strength
+			opt->blur_strength = atof(optarg);
+			break;
+		P_CASELONG(327, blur_iterations);
+		P_CASEBOOL(328, frame_pacing);
+		case 329:
+			// --fade-easing
+			opt->fade_easing = parse_fade_easing(optarg);
+			if (opt->fade_easing >= NUM_FADE_EASING)
+				exit(1);
+			break;
+		case 330:
+			// --damage-rate-rule
+			if (!parse_rule_damage_rate(&opt->damage_rate_rules, optarg))
+				exit(1);
+			break;
+		P_CASELONG(331, release_resources_delay);
+		P_CASELONG(332, event_budget);
+		P_CASELONG(333, timing_log_interval);
+		case 334:
+			// --trace-file
+			free(opt->trace_file);
+			opt->trace_file = strdup(optarg);
+			break;
+		case 335:
+			// --record-events
+			free(opt->record_events);
+			opt->record_events = strdup(optarg);
+			break;
+		case 336:
+			// --replay-events
+			free(opt->replay_events);
+			opt->replay_events = strdup(optarg);
+			break;
+		P_CASELONG(337, resource_budget);
 		P_CASEBOOL(731, reredir_on_root_change);
 		P_CASEBOOL(732, glx_reinit_on_root_change);
 		P_CASEBOOL(800, monitor_repaint);
@@ -804,8 +946,15 @@ void get_cfg(options_t *opt, int argc, char *const *argv, bool shadow_enable,
 	setlocale(LC_NUMERIC, lc_numeric_old);
 	free(lc_numeric_old);
 
-	if (opt->monitor_repaint && opt->backend != BKEND_XRENDER) {
-		log_warn("--monitor-repaint has no effect when backend is not xrender");
+	if (opt->glx_no_rebind_pixmap && opt->glx_force_rebind_pixmap) {
+		log_warn("--glx-no-rebind-pixmap and --glx-force-rebind-pixmap are "
+		         "both set, the former takes precedence");
+		opt->glx_force_rebind_pixmap = false;
+	}
+
+	if (opt->frame_pacing && opt->sw_opti) {
+		log_warn("--frame-pacing replaces --sw-opti, disabling the latter");
+		opt->sw_opti = false;
 	}
 
 	// Range checking and option assignments
@@ -818,6 +967,18 @@ void get_cfg(options_t *opt, int argc, char *const *argv, bool shadow_enable,
 	opt->frame_opacity = normalize_d(opt->frame_opacity);
 	opt->shadow_opacity = normalize_d(opt->shadow_opacity);
 	opt->refresh_rate = normalize_i_range(opt->refresh_rate, 0, 300);
+	opt->blur_strength = normalize_d_range(opt->blur_strength, 0.0, 20.0);
+	opt->blur_iterations = normalize_i_range(opt->blur_iterations, 1, MAX_BLUR_ITERATIONS);
+
+	if (opt->blur_method == BLUR_METHOD_DUAL_KAWASE && opt->backend != BKEND_GLX) {
+		log_warn("--blur-method dual_kawase is only supported by the glx "
+		         "backend, falling back to kernel");
+		opt->blur_method = BLUR_METHOD_KERNEL;
+	}
+	if (opt->blur_method == BLUR_METHOD_DUAL_KAWASE && opt->blur_kerns[0]) {
+		log_warn("--blur-kern has no effect with --blur-method dual_kawase, "
+		         "use --blur-strength and --blur-iterations instead");
+	}
 
 	// Apply default wintype options that are dependent on global options
 	set_default_winopts(opt, winopt_mask, shadow_enable, fading_enable);
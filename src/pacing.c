@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "utils.h"
+
+#include "pacing.h"
+
+/// Extra time given to each frame on top of the prediction, in microseconds.
+#define PACING_SLACK_US 1000L
+
+/// Vblank intervals longer than this are not used to estimate the refresh
+/// interval, since vblanks were probably skipped.
+#define PACING_MAX_INTV_US 100000L
+
+long pacing_now(void) {
+	// Present and DRM report vblank time on CLOCK_MONOTONIC
+	struct timespec tm = {0, 0};
+	clock_gettime(CLOCK_MONOTONIC, &tm);
+	return tm.tv_sec * 1000000L + tm.tv_nsec / 1000;
+}
+
+void pacing_set_refresh_interval(struct frame_pacing *p, long intv) {
+	p->refresh_intv = intv;
+	p->refresh_intv_estimated = !intv;
+}
+
+/// Predicted time from the start of a frame until it is ready to be shown.
+static long pacing_predict(const struct frame_pacing *p) {
+	// Use the slowest recent frame, a missed vblank costs much more than
+	// starting a bit too early.
+	long ret = 0;
+	for (int i = 0; i < p->nsamples; i++) {
+		long total = p->samples[PACING_STAGE_PREPROCESS][i] +
+		             p->samples[PACING_STAGE_RENDER][i];
+		ret = max_l(ret, total);
+	}
+	return ret + PACING_SLACK_US;
+}
+
+double pacing_frame_delay(struct frame_pacing *p, long now) {
+	p->predicted = pacing_predict(p);
+	p->target_vblank = 0;
+	if (!p->refresh_intv || !p->last_vblank || !p->nsamples)
+		return 0;
+
+	// Aim for the first vblank we can make
+	long deadline = now + p->predicted;
+	long next = p->last_vblank;
+	if (deadline >= next)
+		next += ((deadline - next) / p->refresh_intv + 1) * p->refresh_intv;
+	p->target_vblank = next;
+
+	long delay = next - p->predicted - now;
+	if (delay <= 0)
+		return 0;
+	return delay / 1e6;
+}
+
+void pacing_frame_begin(struct frame_pacing *p, long now) {
+	p->frame_start = p->stage_start = now;
+	p->painted = false;
+	memset(p->stage_time, 0, sizeof(p->stage_time));
+}
+
+void pacing_stage_end(struct frame_pacing *p, enum pacing_stage stage, long now) {
+	if (!p->frame_start)
+		return;
+	p->stage_time[stage] = now - p->stage_start;
+	p->stage_start = now;
+	if (stage == PACING_STAGE_RENDER)
+		p->painted = true;
+}
+
+void pacing_frame_end(struct frame_pacing *p, long now) {
+	if (!p->frame_start)
+		return;
+	p->frame_start = 0;
+	// Frames without damage don't tell us anything
+	if (!p->painted) {
+		p->target_vblank = 0;
+		return;
+	}
+	p->pending_target = p->target_vblank;
+	p->target_vblank = 0;
+
+	pacing_stage_end(p, PACING_STAGE_PRESENT, now);
+	for (int i = 0; i < NUM_PACING_STAGES; i++)
+		p->samples[i][p->next_sample] = p->stage_time[i];
+	p->next_sample = (p->next_sample + 1) % PACING_NSAMPLES;
+	p->nsamples = min_i(p->nsamples + 1, PACING_NSAMPLES);
+
+	p->actual = p->stage_time[PACING_STAGE_PREPROCESS] +
+	            p->stage_time[PACING_STAGE_RENDER];
+	p->frames++;
+	log_debug("Frame %lu: predicted %ld us, took %ld us (preprocess %ld, render "
+	          "%ld, present %ld)",
+	          p->frames, p->predicted, p->actual,
+	          p->stage_time[PACING_STAGE_PREPROCESS],
+	          p->stage_time[PACING_STAGE_RENDER],
+	          p->stage_time[PACING_STAGE_PRESENT]);
+}
+
+long pacing_last_stage_time(const struct frame_pacing *p, enum pacing_stage stage) {
+	if (!p->nsamples)
+		return 0;
+	return p->samples[stage][(p->next_sample + PACING_NSAMPLES - 1) % PACING_NSAMPLES];
+}
+
+void pacing_vblank(struct frame_pacing *p, long when) {
+	if (p->refresh_intv_estimated && p->last_vblank && when > p->last_vblank &&
+	    when - p->last_vblank < PACING_MAX_INTV_US) {
+		long intv = when - p->last_vblank;
+		// Moving average, ignoring single long gaps in the first samples
+		if (!p->refresh_intv || intv < p->refresh_intv * 3 / 2)
+			p->refresh_intv = p->refresh_intv ? (p->refresh_intv * 7 + intv) / 8
+			                                  : intv;
+	}
+
+	// With blocking VSync methods the vblank comes while the frame is being
+	// painted, otherwise it comes after.
+	long *target = p->frame_start ? &p->target_vblank : &p->pending_target;
+	if (*target && p->refresh_intv && when > *target + p->refresh_intv / 2) {
+		p->missed++;
+		log_debug("Frame missed its vblank by %ld us", when - *target);
+	}
+	*target = 0;
+	p->last_vblank = when;
+}
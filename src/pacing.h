@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+
+/// Predictive frame scheduling, used with `--frame-pacing`.
+///
+/// Keeps the render time of recent frames, split in stages, and the time of
+/// the last vblank. A frame is started just early enough for the slowest of
+/// the recent frames to finish before the next vblank, instead of right after
+/// the damage comes in.
+
+/// Number of recent frames used for prediction.
+#define PACING_NSAMPLES 16
+
+enum pacing_stage {
+	/// paint_preprocess()
+	PACING_STAGE_PREPROCESS,
+	/// Painting, until the frame is ready to be shown
+	PACING_STAGE_RENDER,
+	/// Waiting for vblank and presenting
+	PACING_STAGE_PRESENT,
+	NUM_PACING_STAGES,
+};
+
+struct frame_pacing {
+	/// Time spent in each stage by recent frames, in microseconds.
+	long samples[NUM_PACING_STAGES][PACING_NSAMPLES];
+	/// Number of valid samples.
+	int nsamples;
+	/// Where the next sample is stored.
+	int next_sample;
+
+	/// Start of the frame being painted, 0 if none.
+	long frame_start;
+	/// Start of the current stage.
+	long stage_start;
+	/// Time spent in each stage by the frame being painted.
+	long stage_time[NUM_PACING_STAGES];
+	/// Whether anything has been painted in this frame.
+	bool painted;
+
+	/// Refresh interval, 0 if unknown.
+	long refresh_intv;
+	/// Whether refresh_intv is estimated from vblank timestamps.
+	bool refresh_intv_estimated;
+	/// Time of the last vblank, 0 if unknown.
+	long last_vblank;
+	/// The vblank the current frame aims for, 0 if none.
+	long target_vblank;
+	/// The vblank the last painted frame aims for, until it is shown.
+	long pending_target;
+
+	/// Render time predicted for the last frame.
+	long predicted;
+	/// Render time of the last frame, i.e. the time until it was ready to be
+	/// shown.
+	long actual;
+	/// Number of frames painted.
+	unsigned long frames;
+	/// Number of frames shown later than the vblank they aimed for.
+	unsigned long missed;
+};
+
+/// Current time in microseconds, on the clock of vblank timestamps.
+long pacing_now(void);
+
+/// Set the refresh interval in microseconds. 0 means it will be estimated from
+/// vblank timestamps.
+void pacing_set_refresh_interval(struct frame_pacing *, long intv);
+
+/// How long, in seconds, to wait before starting the next frame.
+double pacing_frame_delay(struct frame_pacing *, long now);
+
+void pacing_frame_begin(struct frame_pacing *, long now);
+/// Mark the end of `stage` of the current frame.
+void pacing_stage_end(struct frame_pacing *, enum pacing_stage stage, long now);
+void pacing_frame_end(struct frame_pacing *, long now);
+
+/// Time spent in `stage` by the last painted frame.
+long pacing_last_stage_time(const struct frame_pacing *, enum pacing_stage stage);
+
+/// Record that a vblank happened at `when`.
+void pacing_vblank(struct frame_pacing *, long when);
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <xcb/present.h>
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+
+#include "common.h"
+#include "latency.h"
+#include "log.h"
+#include "pacing.h"
+#include "region.h"
+#include "render.h"
+#include "roundtrip.h"
+#include "timing.h"
+#include "utils.h"
+#include "x.h"
+
+#include "present.h"
+
+bool present_init(session_t *ps) {
+	if (ps->o.backend != BKEND_XRENDER) {
+		log_error("Present VSync only works with the xrender backend.");
+		return false;
+	}
+	if (!ps->present_exists) {
+		log_error("X Present extension is not available.");
+		return false;
+	}
+	if (ps->present_eid)
+		return true;
+
+	ps->present_eid = xcb_generate_id(ps->c);
+	xcb_generic_error_t *e = X_ROUND_TRIP(
+	    "present_select_input",
+	    xcb_request_check(ps->c, xcb_present_select_input_checked(
+	                                 ps->c, ps->present_eid, get_tgt_window(ps),
+	                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY |
+	                                     XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY)));
+	if (e) {
+		log_error("Failed to select Present events.");
+		free(e);
+		ps->present_eid = XCB_NONE;
+		return false;
+	}
+
+	ps->present_cur = -1;
+	ps->present_pending = false;
+	return true;
+}
+
+void present_deinit(session_t *ps) {
+	if (ps->present_eid) {
+		xcb_present_select_input(ps->c, ps->present_eid, get_tgt_window(ps),
+		                         XCB_PRESENT_EVENT_MASK_NO_EVENT);
+		ps->present_eid = XCB_NONE;
+	}
+
+	present_drop_buffers(ps);
+	ps->present_pending = false;
+}
+
+bool present_can_paint(session_t *ps) {
+	if (ps->present_pending)
+		return false;
+	if (ps->present_cur >= 0)
+		return true;
+	for (int i = 0; i < PRESENT_NBUFFERS; i++)
+		if (!ps->present_bufs[i].busy)
+			return true;
+	return false;
+}
+
+bool present_acquire_buffer(session_t *ps) {
+	if (ps->present_cur >= 0)
+		return true;
+
+	// Among the idle buffers, prefer the one presented last, as it needs the
+	// least repainting.
+	int cur = -1;
+	for (int i = 0; i < PRESENT_NBUFFERS; i++) {
+		const present_buffer_t *b = &ps->present_bufs[i];
+		if (!b->busy && (cur < 0 || b->frame > ps->present_bufs[cur].frame))
+			cur = i;
+	}
+	if (cur < 0)
+		return false;
+
+	present_buffer_t *b = &ps->present_bufs[cur];
+	if (b->paint.pixmap &&
+	    (b->width != ps->root_width || b->height != ps->root_height)) {
+		free_paint(ps, &b->paint);
+		*b = (present_buffer_t){.paint = PAINT_INIT};
+	}
+	if (!b->paint.pixmap) {
+		b->paint.pixmap = x_create_pixmap(ps->c, ps->depth, ps->root,
+		                                  ps->root_width, ps->root_height);
+		if (b->paint.pixmap == XCB_NONE) {
+			log_error("Failed to allocate a screen-sized back buffer.");
+			return false;
+		}
+		b->paint.pict = x_create_picture_with_visual_and_pixmap(
+		    ps->c, ps->vis, b->paint.pixmap, 0, 0);
+		b->width = ps->root_width;
+		b->height = ps->root_height;
+		b->frame = 0;
+	}
+
+	ps->present_cur = cur;
+	ps->tgt_buffer = b->paint;
+	return true;
+}
+
+void present_unacquire_buffer(session_t *ps) {
+	if (ps->present_cur < 0)
+		return;
+	ps->present_cur = -1;
+	ps->tgt_buffer = (paint_t)PAINT_INIT;
+}
+
+int present_buffer_age(session_t *ps) {
+	if (ps->present_cur < 0)
+		return -1;
+	const present_buffer_t *b = &ps->present_bufs[ps->present_cur];
+	if (!b->frame)
+		return -1;
+	return (int)(ps->present_frame + 1 - b->frame);
+}
+
+void present_release_buffers(session_t *ps) {
+	for (int i = 0; i < PRESENT_NBUFFERS; i++) {
+		present_buffer_t *b = &ps->present_bufs[i];
+		if (i == ps->present_cur || b->busy)
+			continue;
+		free_paint(ps, &b->paint);
+		*b = (present_buffer_t){.paint = PAINT_INIT};
+	}
+}
+
+void present_drop_buffers(session_t *ps) {
+	// A buffer still being painted to is also the target buffer
+	present_unacquire_buffer(ps);
+	// The server keeps its own reference to the pixmaps it holds, and their
+	// IdleNotify won't match anything anymore.
+	for (int i = 0; i < PRESENT_NBUFFERS; i++) {
+		free_paint(ps, &ps->present_bufs[i].paint);
+		ps->present_bufs[i] = (present_buffer_t){.paint = PAINT_INIT};
+	}
+}
+
+/// Convert a region to a new XFixes region.
+static xcb_xfixes_region_t present_create_region(session_t *ps, const region_t *reg) {
+	int nrects;
+	const rect_t *rects = pixman_region32_rectangles((region_t *)reg, &nrects);
+	auto xrects = ccalloc(nrects, xcb_rectangle_t);
+	for (int i = 0; i < nrects; i++)
+		xrects[i] = (xcb_rectangle_t){
+		    .x = rects[i].x1,
+		    .y = rects[i].y1,
+		    .width = rects[i].x2 - rects[i].x1,
+		    .height = rects[i].y2 - rects[i].y1,
+		};
+
+	xcb_xfixes_region_t ret = xcb_generate_id(ps->c);
+	xcb_xfixes_create_region(ps->c, ret, nrects, xrects);
+	free(xrects);
+	return ret;
+}
+
+void present_pixmap(session_t *ps, const region_t *region) {
+	assert(ps->present_cur >= 0);
+	present_buffer_t *b = &ps->present_bufs[ps->present_cur];
+
+	// The update region only limits what is copied. When the server flips
+	// instead, the whole buffer is shown, which is fine because the buffer
+	// age makes sure all of it is up to date.
+	xcb_xfixes_region_t update = present_create_region(ps, region);
+	ps->present_frame++;
+	// Not checked, so we don't wait for the server here. Errors are reported
+	// by the error handler.
+	xcb_present_pixmap(ps->c, get_tgt_window(ps), b->paint.pixmap,
+	                   (uint32_t)ps->present_frame, XCB_NONE, update, 0, 0, XCB_NONE,
+	                   XCB_NONE, XCB_NONE, XCB_PRESENT_OPTION_NONE, 0, 0, 0, 0, NULL);
+	xcb_xfixes_destroy_region(ps->c, update);
+
+	ps->present_cur = -1;
+	ps->tgt_buffer = (paint_t)PAINT_INIT;
+	b->busy = true;
+	b->frame = ps->present_frame;
+	ps->present_pending = true;
+}
+
+bool present_handle_event(session_t *ps, xcb_generic_event_t *ev) {
+	if (!ps->present_exists || ev->response_type != XCB_GE_GENERIC)
+		return false;
+	auto gev = (xcb_ge_generic_event_t *)ev;
+	if (gev->extension != ps->present_opcode)
+		return false;
+
+	switch (gev->event_type) {
+	case XCB_PRESENT_EVENT_COMPLETE_NOTIFY: {
+		auto cev = (xcb_present_complete_notify_event_t *)ev;
+		if (cev->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP ||
+		    cev->serial != (uint32_t)ps->present_frame)
+			break;
+		ps->present_pending = false;
+		ps->present_msc = cev->msc;
+		if (ps->pacing)
+			pacing_vblank(ps->pacing, (long)cev->ust);
+		latency_frame_shown(ps->latency, (long)cev->ust);
+		frame_timing_shown(ps->timing, (long)cev->ust, ps->refresh_intv);
+		break;
+	}
+	case XCB_PRESENT_EVENT_IDLE_NOTIFY: {
+		auto iev = (xcb_present_idle_notify_event_t *)ev;
+		for (int i = 0; i < PRESENT_NBUFFERS; i++)
+			if (ps->present_bufs[i].paint.pixmap == iev->pixmap)
+				ps->present_bufs[i].busy = false;
+		break;
+	}
+	default: return true;
+	}
+
+	// Damage that came in while we were waiting can be painted now
+	resume_redraw(ps);
+	return true;
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+#include "region.h"
+
+/// Presentation of the XRender back buffer through the X Present extension,
+/// used with `--vsync present`.
+///
+/// Frames are painted into one of PRESENT_NBUFFERS back pixmaps, which is then
+/// handed to the server with PresentPixmap. CompleteNotify tells us when the
+/// frame hit the screen, so the next one can be started, and IdleNotify tells
+/// us when a pixmap can be painted to again.
+
+typedef struct session session_t;
+
+bool present_init(session_t *ps);
+void present_deinit(session_t *ps);
+
+/// Whether a new frame can be painted now, i.e. the previous one has been
+/// presented and there is a back buffer the server doesn't hold.
+bool present_can_paint(session_t *ps);
+
+/// Make an idle back buffer the target buffer of the next frame.
+bool present_acquire_buffer(session_t *ps);
+
+/// Give the acquired back buffer back without presenting it, for frames that
+/// end up painting nothing.
+void present_unacquire_buffer(session_t *ps);
+
+/// Age of the acquired back buffer, -1 if its content is undefined.
+int present_buffer_age(session_t *ps);
+
+/// Free the back buffers the X server doesn't hold, they are recreated when
+/// needed.
+void present_release_buffers(session_t *ps);
+
+/// Free all back buffers, including the acquired one and those the X server
+/// still holds, e.g. because the screen size changed.
+void present_drop_buffers(session_t *ps);
+
+/// Present the acquired back buffer, updating `region` of the screen.
+void present_pixmap(session_t *ps, const region_t *region);
+
+/// Handle a Present extension event. Returns false if `ev` is not one.
+bool present_handle_event(session_t *ps, xcb_generic_event_t *ev);
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+
+/// Static probes for tracing with perf, bpftrace or SystemTap, under the
+/// provider "compton".
+///
+/// When built with -Dusdt=true, a probe is a nop instruction plus a note that
+/// tells tracers where it is and how to find its arguments. A tracer attaching
+/// to it turns it into a breakpoint. The arguments are computed even when no
+/// tracer is attached, so they have to be cheap. Otherwise probes compile to
+/// nothing.
+///
+/// Every probe takes at least one argument, which has to be an integer or a
+/// pointer.
+
+#ifdef CONFIG_USDT
+#include <sys/sdt.h>
+#define PROBE(name, ...) STAP_PROBEV(compton, name, __VA_ARGS__)
+#else
+#define PROBE(name, ...) ((void)0)
+#endif
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "log.h"
+#include "pacing.h"
+#include "utils.h"
+
+#include "record.h"
+
+#define RECORD_MAGIC "CMPTNREC"
+#define RECORD_VERSION 2
+
+struct record_file_header {
+	char magic[8];
+	uint32_t version;
+	/// Root window of the recording.
+	uint32_t root;
+};
+
+/// Header of a record, followed by `len` bytes of data.
+struct record_header {
+	uint8_t type;
+	uint8_t tag;
+	uint16_t pad;
+	uint32_t len;
+	/// Time since the recording started, in microseconds.
+	int64_t time;
+};
+
+struct recorder {
+	FILE *f;
+	bool replaying;
+	long start;
+	/// Root window of the recording, and the one it is replayed on.
+	xcb_window_t recorded_root, root;
+	/// The next record of the replay, if `peeked`. Its data has not been read.
+	struct record_header next;
+	bool peeked;
+	/// Number of records written or read.
+	unsigned long records;
+	/// Number of replies that didn't match what the replay asked for.
+	unsigned long mismatches;
+};
+
+struct recorder *active_recorder = NULL;
+
+static struct recorder *record_open(const char *path, bool replaying) {
+	FILE *f = fopen(path, replaying ? "rb" : "wb");
+	if (!f) {
+		log_error("Failed to open %s.", path);
+		return NULL;
+	}
+	auto r = ccalloc(1, struct recorder);
+	r->f = f;
+	r->replaying = replaying;
+	r->start = pacing_now();
+	return r;
+}
+
+bool record_start(const char *path, xcb_window_t root) {
+	assert(!active_recorder);
+	auto r = record_open(path, false);
+	if (!r)
+		return false;
+
+	struct record_file_header h = {
+	    .magic = RECORD_MAGIC, .version = RECORD_VERSION, .root = root};
+	if (fwrite(&h, sizeof(h), 1, r->f) != 1) {
+		log_error("Failed to write to %s.", path);
+		fclose(r->f);
+		free(r);
+		return false;
+	}
+	log_info("Recording events to %s.", path);
+	active_recorder = r;
+	return true;
+}
+
+bool replay_start(const char *path, xcb_window_t root) {
+	assert(!active_recorder);
+	auto r = record_open(path, true);
+	if (!r)
+		return false;
+
+	struct record_file_header h;
+	if (fread(&h, sizeof(h), 1, r->f) != 1 ||
+	    memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) != 0) {
+		log_error("%s is not an event recording.", path);
+		goto err;
+	}
+	if (h.version != RECORD_VERSION) {
+		log_error("%s is recorded in version %u, only version %d can be "
+		          "replayed.",
+		          path, h.version, RECORD_VERSION);
+		goto err;
+	}
+	r->recorded_root = h.root;
+	r->root = root;
+	log_info("Replaying events from %s.", path);
+	active_recorder = r;
+	return true;
+
+err:
+	fclose(r->f);
+	free(r);
+	return false;
+}
+
+void record_stop(void) {
+	struct recorder *r = active_recorder;
+	if (!r)
+		return;
+	if (r->mismatches)
+		log_warn("%lu replies of the replay didn't match the recording, it "
+		         "was made with a different build or configuration.",
+		         r->mismatches);
+	log_info("%s %lu records.", r->replaying ? "Replayed" : "Recorded",
+	         r->records);
+	fclose(r->f);
+	free(r);
+	active_recorder = NULL;
+}
+
+static void record_write(struct recorder *r, enum record_type type, uint8_t tag,
+                         const void *data, uint32_t len) {
+	struct record_header h = {
+	    .type = (uint8_t)type, .tag = tag, .len = len, .time = pacing_now() - r->start};
+	// Stdio buffers the writes, so this rarely waits for the disk
+	if (fwrite(&h, sizeof(h), 1, r->f) != 1 ||
+	    (len && fwrite(data, len, 1, r->f) != 1)) {
+		log_error("Failed to write the event recording, stopping.");
+		record_stop();
+		return;
+	}
+	r->records++;
+}
+
+/// Size of an event, as returned by xcb. Generic events carry more data, which
+/// xcb moves behind full_sequence.
+static uint32_t event_size(const xcb_generic_event_t *ev) {
+	if ((ev->response_type & 0x7f) != XCB_GE_GENERIC)
+		return sizeof(*ev);
+	const xcb_ge_generic_event_t *gev = (const xcb_ge_generic_event_t *)ev;
+	return (uint32_t)sizeof(*gev) + 4 * gev->length;
+}
+
+void record_event_slow(const xcb_generic_event_t *ev) {
+	if (!active_recorder->replaying)
+		record_write(active_recorder, RECORD_EVENT, 0, ev, event_size(ev));
+}
+
+void record_frame_slow(void) {
+	if (!active_recorder->replaying)
+		record_write(active_recorder, RECORD_FRAME, 0, NULL, 0);
+}
+
+/// Size of a reply or error, as returned by xcb.
+static uint32_t reply_size(const void *reply) {
+	const xcb_generic_reply_t *r = reply;
+	if (r->response_type == 0)
+		return sizeof(xcb_generic_error_t);
+	return 32 + 4 * r->length;
+}
+
+/// Read the header of the next record, if it hasn't been read.
+static bool replay_peek(struct recorder *r) {
+	if (!r->peeked)
+		r->peeked = fread(&r->next, sizeof(r->next), 1, r->f) == 1;
+	return r->peeked;
+}
+
+/// Read the data of the record peeked at, NULL if it has none.
+static void *replay_read(struct recorder *r, size_t min_size) {
+	r->peeked = false;
+	r->records++;
+	if (!r->next.len)
+		return NULL;
+	void *data = ccalloc(max_l(r->next.len, (long)min_size), char);
+	if (fread(data, r->next.len, 1, r->f) != 1) {
+		log_warn("The event recording is cut short.");
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+static inline void replay_fix_root(struct recorder *r, xcb_window_t *w) {
+	if (*w == r->recorded_root)
+		*w = r->root;
+}
+
+void *record_reply_slow(enum record_tag tag, void *reply) {
+	struct recorder *r = active_recorder;
+	if (!r->replaying) {
+		record_write(r, RECORD_REPLY, (uint8_t)tag, reply,
+		             reply ? reply_size(reply) : 0);
+		return reply;
+	}
+
+	if (!replay_peek(r) || r->next.type != RECORD_REPLY || r->next.tag != tag) {
+		// Use what the X server says, and hope the replay gets back in step
+		r->mismatches++;
+		return reply;
+	}
+	free(reply);
+	reply = replay_read(r, 0);
+	if (reply && tag == RECORD_TAG_QUERY_TREE &&
+	    ((xcb_generic_reply_t *)reply)->response_type) {
+		xcb_query_tree_reply_t *tree = reply;
+		replay_fix_root(r, &tree->root);
+		replay_fix_root(r, &tree->parent);
+	}
+	return reply;
+}
+
+/// Put the root window of the replay in place of the recorded one.
+static void replay_fix_event(struct recorder *r, xcb_generic_event_t *ev) {
+	switch (ev->response_type & 0x7f) {
+	case XCB_FOCUS_IN:
+	case XCB_FOCUS_OUT:
+		replay_fix_root(r, &((xcb_focus_in_event_t *)ev)->event);
+		break;
+	case XCB_CREATE_NOTIFY:
+		replay_fix_root(r, &((xcb_create_notify_event_t *)ev)->parent);
+		break;
+	case XCB_CONFIGURE_NOTIFY:
+		replay_fix_root(r, &((xcb_configure_notify_event_t *)ev)->event);
+		replay_fix_root(r, &((xcb_configure_notify_event_t *)ev)->window);
+		break;
+	case XCB_DESTROY_NOTIFY:
+		replay_fix_root(r, &((xcb_destroy_notify_event_t *)ev)->event);
+		break;
+	case XCB_MAP_NOTIFY:
+		replay_fix_root(r, &((xcb_map_notify_event_t *)ev)->event);
+		break;
+	case XCB_UNMAP_NOTIFY:
+		replay_fix_root(r, &((xcb_unmap_notify_event_t *)ev)->event);
+		break;
+	case XCB_REPARENT_NOTIFY:
+		replay_fix_root(r, &((xcb_reparent_notify_event_t *)ev)->event);
+		replay_fix_root(r, &((xcb_reparent_notify_event_t *)ev)->parent);
+		break;
+	case XCB_CIRCULATE_NOTIFY:
+		replay_fix_root(r, &((xcb_circulate_notify_event_t *)ev)->event);
+		break;
+	case XCB_EXPOSE:
+		replay_fix_root(r, &((xcb_expose_event_t *)ev)->window);
+		break;
+	case XCB_PROPERTY_NOTIFY:
+		replay_fix_root(r, &((xcb_property_notify_event_t *)ev)->window);
+		break;
+	}
+}
+
+enum record_type replay_next(xcb_generic_event_t **ev) {
+	struct recorder *r = active_recorder;
+	while (replay_peek(r)) {
+		switch (r->next.type) {
+		case RECORD_EVENT:
+			*ev = replay_read(r, sizeof(xcb_generic_event_t));
+			if (!*ev)
+				return RECORD_END;
+			if (r->next.len < event_size(*ev)) {
+				// The handlers would read past its end
+				log_warn("Skipping a truncated event in the recording.");
+				free(*ev);
+				*ev = NULL;
+				continue;
+			}
+			replay_fix_event(r, *ev);
+			return RECORD_EVENT;
+		case RECORD_FRAME: replay_read(r, 0); return RECORD_FRAME;
+		default:
+			// A reply the replay didn't ask for
+			r->mismatches++;
+			free(replay_read(r, 0));
+		}
+	}
+	return RECORD_END;
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/// Recording and replaying of the X events compton handles, for profiling
+/// event handling offline.
+///
+/// A recording has every event ev_handle() sees, the replies to the requests
+/// compton waits on while handling them, and where frames were painted, all
+/// in the order they happened. A replay feeds the events back to the event
+/// handlers as fast as possible, and answers the recorded requests from the
+/// recording instead of the X server, so the handlers see the same windows
+/// and properties as when recording.
+///
+/// Replies are matched up by order, so a recording can only be replayed with
+/// the same build and configuration it was made with.
+
+enum record_type {
+	/// An X event, as passed to ev_handle()
+	RECORD_EVENT,
+	/// The reply to a request, or its error
+	RECORD_REPLY,
+	/// paint_preprocess() was about to run
+	RECORD_FRAME,
+	/// End of the recording, never written
+	RECORD_END,
+};
+
+/// Requests whose replies are recorded.
+enum record_tag {
+	RECORD_TAG_GET_PROPERTY,
+	RECORD_TAG_QUERY_TREE,
+	RECORD_TAG_GET_INPUT_FOCUS,
+	RECORD_TAG_GET_ATOM_NAME,
+	RECORD_TAG_GET_WINDOW_ATTRIBUTES,
+	RECORD_TAG_GET_GEOMETRY,
+	RECORD_TAG_SHAPE_QUERY_EXTENTS,
+	RECORD_TAG_SHAPE_GET_RECTANGLES,
+	RECORD_TAG_FETCH_REGION,
+	RECORD_TAG_DAMAGE_CREATE,
+};
+
+struct recorder;
+
+/// The recording or replay in progress, if any.
+extern struct recorder *active_recorder;
+
+/// Start recording to the file at `path`.
+bool record_start(const char *path, xcb_window_t root);
+
+/// Start replaying the file at `path`. The root window of the recording is
+/// replaced by `root` in events.
+bool replay_start(const char *path, xcb_window_t root);
+
+/// Stop recording or replaying.
+void record_stop(void);
+
+void record_event_slow(const xcb_generic_event_t *ev);
+void record_frame_slow(void);
+void *record_reply_slow(enum record_tag tag, void *reply);
+
+/// Record an event, if recording.
+static inline void record_event(const xcb_generic_event_t *ev) {
+	if (active_recorder)
+		record_event_slow(ev);
+}
+
+/// Record the start of a frame, if recording.
+static inline void record_frame(void) {
+	if (active_recorder)
+		record_frame_slow();
+}
+
+/// Pass a reply or error from the X server through the recorder.
+///
+/// When recording, the reply is written and returned. When replaying, it is
+/// freed, and the recorded one is returned instead. `reply` can be NULL.
+static inline void *record_reply(enum record_tag tag, void *reply) {
+	return active_recorder ? record_reply_slow(tag, reply) : reply;
+}
+
+/// Get the next event or frame of the replay.
+///
+/// @param ev where the event is returned, which has to be freed
+/// @return RECORD_EVENT, RECORD_FRAME, or RECORD_END when the replay is over
+enum record_type replay_next(xcb_generic_event_t **ev);
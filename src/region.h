@@ -51,3 +51,35 @@ from_x_rects(int nrects, const xcb_rectangle_t *rects) {
     ret[i] = from_x_rect(rects+i);
   return ret;
 }
+
+/**
+ * Resize a region.
+ */
+static inline void
+resize_region(region_t *region, short mod) {
+  if (!mod || !region)
+    return;
+  // Loop through all rectangles
+  int nrects;
+  int nnewrects = 0;
+  pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
+  auto newrects = ccalloc(nrects, pixman_box32_t);
+  for (int i = 0; i < nrects; i++) {
+    int x1 = rects[i].x1 - mod;
+    int y1 = rects[i].y1 - mod;
+    int x2 = rects[i].x2 + mod;
+    int y2 = rects[i].y2 + mod;
+    int wid = x2 - x1;
+    int hei = y2 - y1;
+    if (wid <= 0 || hei <= 0)
+      continue;
+    newrects[nnewrects] =
+      (pixman_box32_t) {.x1 = x1, .x2 = x2, .y1 = y1, .y2 = y2};
+    ++nnewrects;
+  }
+
+  pixman_region32_fini(region);
+  pixman_region32_init_rects(region, newrects, nnewrects);
+
+  free(newrects);
+}
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <xcb/composite.h>
@@ -13,15 +14,23 @@
 #include "options.h"
 
 #ifdef CONFIG_OPENGL
+#include "backend/gl/gl_common.h"
 #include "backend/gl/glx.h"
 #include "opengl.h"
 #endif
 
 #include "compiler.h"
 #include "config.h"
+#include "heatmap.h"
 #include "kernel.h"
+#include "latency.h"
 #include "log.h"
+#include "pacing.h"
+#include "present.h"
+#include "probe.h"
 #include "region.h"
+#include "timing.h"
+#include "trace.h"
 #include "types.h"
 #include "utils.h"
 #include "vsync.h"
@@ -33,10 +42,13 @@
 
 /**
  * Bind texture in paint_t if we are using GLX backend.
+ *
+ * @param damaged whether the pixmap content changed since it was last bound.
+ *                The texture is only rebound if the driver needs it.
  */
 static inline bool
 paint_bind_tex(session_t *ps, paint_t *ppaint, unsigned wid, unsigned hei, bool repeat,
-               int depth, xcb_visualid_t visual, bool force) {
+               int depth, xcb_visualid_t visual, bool damaged) {
 #ifdef CONFIG_OPENGL
 	// XXX This is a mess. But this will go away after the backend refactor.
 	static thread_local struct glx_fbconfig_info *argb_fbconfig = NULL;
@@ -79,8 +91,13 @@ paint_bind_tex(session_t *ps, paint_t *ppaint, unsigned wid, unsigned hei, bool
 			return false;
 		}
 		fbcfg = ppaint->fbcfg;
+		depth = m.visual_depth;
 	}
 
+	bool force = false;
+	if (damaged && glx_tex_binded(ppaint->ptex, ppaint->pixmap))
+		force = glx_tfp_need_rebind(ps, depth);
+
 	if (force || !glx_tex_binded(ppaint->ptex, ppaint->pixmap))
 		return glx_bind_pixmap(ps, &ppaint->ptex, ppaint->pixmap, wid, hei,
 		                       repeat, fbcfg);
@@ -99,6 +116,9 @@ int maximum_buffer_age(session_t *ps) {
 	if (bkend_use_glx(ps) && ps->o.glx_swap_method == SWAPM_BUFFER_AGE) {
 		return CGLX_MAX_BUFFER_AGE;
 	}
+	if (ps->o.vsync == VSYNC_PRESENT) {
+		return PRESENT_NBUFFERS;
+	}
 	return 1;
 }
 
@@ -115,7 +135,12 @@ static int get_buffer_age(session_t *ps) {
 		}
 	}
 #endif
-	return 1;
+	if (ps->o.vsync == VSYNC_PRESENT) {
+		return present_buffer_age(ps);
+	}
+	// The XRender back buffer is kept across frames, so it always holds the
+	// previous frame, unless it has just been (re)allocated.
+	return ps->tgt_buffer.pict ? 1 : -1;
 }
 
 /**
@@ -259,7 +284,7 @@ void paint_one(session_t *ps, win *w, const region_t *reg_paint) {
 	// is resizing windows, the width and height we get may not be up-to-date,
 	// causing the jittering issue M4he reported in #7.
 	if (!paint_bind_tex(ps, &w->paint, 0, 0, false, 0, w->a.visual,
-	                    (!ps->o.glx_no_rebind_pixmap && w->pixmap_damaged))) {
+	                    w->pixmap_damaged)) {
 		log_error("Failed to bind texture for window %#010x.", w->id);
 	}
 	w->pixmap_damaged = false;
@@ -748,41 +773,131 @@ static inline void win_blur_background(session_t *ps, win *w, xcb_render_picture
 	}
 }
 
-/**
- * Resize a region.
- */
-static inline void resize_region(region_t *region, short mod) {
-	if (!mod || !region)
-		return;
-	// Loop through all rectangles
-	int nrects;
-	int nnewrects = 0;
-	pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
-	auto newrects = ccalloc(nrects, pixman_box32_t);
-	for (int i = 0; i < nrects; i++) {
-		int x1 = rects[i].x1 - mod;
-		int y1 = rects[i].y1 - mod;
-		int x2 = rects[i].x2 + mod;
-		int y2 = rects[i].y2 + mod;
-		int wid = x2 - x1;
-		int hei = y2 - y1;
-		if (wid <= 0 || hei <= 0)
+/// Put the frame painted to the target buffer on screen, `region` being the
+/// part of it that has been updated.
+void paint_commit(session_t *ps, const region_t *region) {
+	switch (ps->o.backend) {
+	case BKEND_XRENDER:
+		if (ps->o.vsync == VSYNC_PRESENT) {
+			present_pixmap(ps, region);
+		} else {
+			// The target keeps its content as well, so only what has been
+			// painted this frame needs to be copied. tgt_picture is already
+			// clipped to the paint region, limiting the request to its
+			// extents keeps the server from walking the whole screen.
+			const pixman_box32_t *ext = pixman_region32_extents((region_t *)region);
+			xcb_render_composite(ps->c, XCB_RENDER_PICT_OP_SRC, ps->tgt_buffer.pict,
+			                     XCB_NONE, ps->tgt_picture, ext->x1, ext->y1, 0,
+			                     0, ext->x1, ext->y1, ext->x2 - ext->x1,
+			                     ext->y2 - ext->y1);
+		}
+		break;
+#ifdef CONFIG_OPENGL
+	case BKEND_XR_GLX_HYBRID:
+		x_sync(ps->c);
+		if (ps->o.vsync_use_glfinish)
+			glFinish();
+		else
+			glFlush();
+		glXWaitX();
+		assert(ps->tgt_buffer.pixmap);
+		paint_bind_tex(ps, &ps->tgt_buffer, ps->root_width, ps->root_height, false,
+		               ps->depth, ps->vis, true);
+		if (ps->o.vsync_use_glfinish)
+			glFinish();
+		else
+			glFlush();
+		glXWaitX();
+		glx_render(ps, ps->tgt_buffer.ptex, 0, 0, 0, 0, ps->root_width,
+		           ps->root_height, 0, 1.0, false, false, region, NULL);
+		// falls through
+	case BKEND_GLX: glXSwapBuffers(ps->dpy, get_tgt_window(ps)); break;
+#endif
+	default: assert(0);
+	}
+}
+
+/// Colors of the heat map levels of --monitor-repaint, from cold to hot.
+static const struct {
+	double red, green, blue, alpha;
+} heatmap_colors[HEATMAP_NLEVELS] = {
+    {0, 0, 1, 0.2}, {0, 1, 0, 0.25}, {1, 1, 0, 0.3}, {1, 0, 0, 0.35},
+};
+
+/// Paint the repaint heat map over `region`, the part of the screen painted
+/// this frame. The area it covers is damaged for the next frame, which paints
+/// it again as it cools down.
+static void paint_heatmap(session_t *ps, region_t *region) {
+	struct heatmap *h = ps->heatmap;
+	heatmap_resize(h, ps->root_width, ps->root_height);
+
+	region_t reg;
+	pixman_region32_init(&reg);
+	set_tgt_clip(ps, region);
+	for (int i = 0; i < HEATMAP_NLEVELS; i++) {
+		heatmap_region(h, i, &reg);
+		pixman_region32_intersect(&reg, &reg, region);
+		if (!pixman_region32_not_empty(&reg))
 			continue;
-		newrects[nnewrects] =
-		    (pixman_box32_t){.x1 = x1, .x2 = x2, .y1 = y1, .y2 = y2};
-		++nnewrects;
+
+		switch (ps->o.backend) {
+		case BKEND_XRENDER:
+		case BKEND_XR_GLX_HYBRID: {
+			double a = heatmap_colors[i].alpha;
+			// Premultiply color
+			xcb_render_color_t color = {
+			    .red = (uint16_t)(0xffff * heatmap_colors[i].red * a),
+			    .green = (uint16_t)(0xffff * heatmap_colors[i].green * a),
+			    .blue = (uint16_t)(0xffff * heatmap_colors[i].blue * a),
+			    .alpha = (uint16_t)(0xffff * a),
+			};
+			int nrects;
+			const rect_t *rects = pixman_region32_rectangles(&reg, &nrects);
+			auto xrects = ccalloc(nrects, xcb_rectangle_t);
+			for (int j = 0; j < nrects; j++)
+				xrects[j] = (xcb_rectangle_t){
+				    .x = (int16_t)rects[j].x1,
+				    .y = (int16_t)rects[j].y1,
+				    .width = (uint16_t)(rects[j].x2 - rects[j].x1),
+				    .height = (uint16_t)(rects[j].y2 - rects[j].y1),
+				};
+			xcb_render_fill_rectangles(ps->c, XCB_RENDER_PICT_OP_OVER,
+			                           ps->tgt_buffer.pict, color,
+			                           (uint32_t)nrects, xrects);
+			free(xrects);
+		} break;
+#ifdef CONFIG_OPENGL
+		case BKEND_GLX:
+			glx_fill_dst(ps, &reg, ps->psglx->z, (GLfloat)heatmap_colors[i].red,
+			             (GLfloat)heatmap_colors[i].green,
+			             (GLfloat)heatmap_colors[i].blue,
+			             (GLfloat)heatmap_colors[i].alpha);
+			break;
+#endif
+		default: assert(false);
+		}
 	}
 
-	pixman_region32_fini(region);
-	pixman_region32_init_rects(region, newrects, nnewrects);
+	heatmap_region(h, -1, &reg);
+	damage_history_add(&ps->damage, &reg);
+	pixman_region32_fini(&reg);
+	heatmap_cool(h, pacing_now());
+}
 
-	free(newrects);
+/// End a stage of painting, for frame timing and traces.
+static inline void paint_lap(session_t *ps, enum frame_stage stage, long *lap) {
+	long start = *lap;
+	frame_timing_lap(ps->timing, stage, lap);
+	trace_span(ps->trace, FRAME_STAGE_NAMES[stage], "paint", start, *lap, NULL, 0);
 }
 
 /// paint all windows
 /// region = ??
 /// region_real = the damage region
 void paint_all(session_t *ps, win *const t, bool ignore_damage) {
+	struct frame_timing *timing = ps->timing;
+	long lap = pacing_now();
+
 	if (ps->o.xrender_sync_fence) {
 		if (ps->xsync_exists && !x_fence_sync(ps->c, ps->sync_fence)) {
 			log_error("x_fence_sync failed, xrender-sync-fence will be "
@@ -793,19 +908,21 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 		}
 	}
 
+	// Pick the back buffer first, its age decides what to repaint
+	if (ps->o.vsync == VSYNC_PRESENT && !present_acquire_buffer(ps)) {
+		return;
+	}
+
 	region_t region;
 	pixman_region32_init(&region);
-	int buffer_age = get_buffer_age(ps);
-	if (buffer_age == -1 || buffer_age > ps->ndamage || ignore_damage) {
+	if (ignore_damage || !damage_history_get(&ps->damage, get_buffer_age(ps), &region)) {
 		pixman_region32_copy(&region, &ps->screen_reg);
-	} else {
-		for (int i = 0; i < get_buffer_age(ps); i++) {
-			const int curr = ((ps->damage - ps->damage_ring) + i) % ps->ndamage;
-			pixman_region32_union(&region, &region, &ps->damage_ring[curr]);
-		}
 	}
 
 	if (!pixman_region32_not_empty(&region)) {
+		pixman_region32_fini(&region);
+		if (ps->o.vsync == VSYNC_PRESENT)
+			present_unacquire_buffer(ps);
 		return;
 	}
 
@@ -860,7 +977,9 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 	}
 
 	set_tgt_clip(ps, reg_paint);
+	paint_lap(ps, FRAME_STAGE_REGION, &lap);
 	paint_root(ps, reg_paint);
+	paint_lap(ps, FRAME_STAGE_ROOT, &lap);
 
 	// Windows are sorted from bottom to top
 	// Each window has a reg_ignore, which is the region obscured by all the
@@ -869,13 +988,23 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 	//
 	// Whether this is beneficial is to be determined XXX
 	for (win *w = t; w; w = w->prev_trans) {
+		long win_start = lap;
 		region_t bshape = win_get_bounding_shape_global_by_val(w);
 		// Painting shadow
 		if (w->shadow) {
 			// Lazy shadow building
-			if (!w->shadow_paint.pixmap)
-				if (!win_build_shadow(ps, w, 1))
+			if (!w->shadow_paint.pixmap) {
+				paint_lap(ps, FRAME_STAGE_REGION, &lap);
+				long span = lap;
+				PROBE(shadow_begin, w->id, w->widthb, w->heightb);
+				bool ok = win_build_shadow(ps, w, 1);
+				PROBE(shadow_end, w->id, ok);
+				if (!ok)
 					log_error("build shadow failed");
+				frame_timing_lap(timing, FRAME_STAGE_SHADOW, &lap);
+				trace_span(ps->trace, "win_build_shadow", "paint", span,
+				           lap, NULL, w->id);
+			}
 
 			// Shadow doesn't need to be painted underneath the body
 			// of the windows above. Because no one can see it
@@ -917,7 +1046,9 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 			// Detect if the region is empty before painting
 			if (pixman_region32_not_empty(&reg_tmp)) {
 				set_tgt_clip(ps, &reg_tmp);
+				paint_lap(ps, FRAME_STAGE_REGION, &lap);
 				win_paint_shadow(ps, w, &reg_tmp);
+				paint_lap(ps, FRAME_STAGE_SHADOW, &lap);
 			}
 		}
 
@@ -931,31 +1062,44 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 
 		if (pixman_region32_not_empty(&reg_tmp)) {
 			set_tgt_clip(ps, &reg_tmp);
+			paint_lap(ps, FRAME_STAGE_REGION, &lap);
 			// Blur window background
 			if (w->blur_background &&
 			    (!win_is_solid(ps, w) ||
-			     (ps->o.blur_background_frame && w->frame_opacity != 1)))
+			     (ps->o.blur_background_frame && w->frame_opacity != 1))) {
+				long span = lap;
+				PROBE(blur_begin, w->id, w->widthb, w->heightb);
 				win_blur_background(ps, w, ps->tgt_buffer.pict, &reg_tmp);
+				PROBE(blur_end, w->id);
+				frame_timing_lap(timing, FRAME_STAGE_BLUR, &lap);
+				trace_span(ps->trace, "win_blur_background", "paint",
+				           span, lap, NULL, w->id);
+			}
 
 			// Painting the window
 			paint_one(ps, w, &reg_tmp);
+			paint_lap(ps, FRAME_STAGE_COMPOSITE, &lap);
 		}
+		frame_timing_window(timing, (uint32_t)w->id, lap - win_start);
 	}
 
 	// Free up all temporary regions
 	pixman_region32_fini(&reg_tmp);
 
-	// Move the head of the damage ring
-	ps->damage = ps->damage - 1;
-	if (ps->damage < ps->damage_ring) {
-		ps->damage = ps->damage_ring + ps->ndamage - 1;
+	latency_frame_painted(ps->latency, ps->damage.oldest);
+	damage_history_next_frame(&ps->damage);
+
+	// After moving on to the next frame, so the heat map is damaged in it
+	if (ps->heatmap) {
+		paint_heatmap(ps, &region);
+		paint_lap(ps, FRAME_STAGE_COMPOSITE, &lap);
 	}
-	pixman_region32_clear(ps->damage);
 
 	// Do this as early as possible
 	set_tgt_clip(ps, &ps->screen_reg);
+	paint_lap(ps, FRAME_STAGE_REGION, &lap);
 
-	if (ps->o.vsync) {
+	if (ps->o.vsync && ps->o.vsync != VSYNC_PRESENT) {
 		// Make sure all previous requests are processed to achieve best
 		// effect
 		x_sync(ps->c);
@@ -969,75 +1113,33 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 		}
 #endif
 	}
+	paint_lap(ps, FRAME_STAGE_XSYNC, &lap);
+
+	if (ps->pacing) {
+		pacing_stage_end(ps->pacing, PACING_STAGE_RENDER, lap);
+	}
 
 	// Wait for VBlank. We could do it aggressively (send the painting
 	// request and XFlush() on VBlank) or conservatively (send the request
 	// only on VBlank).
 	// TODO Investigate and potentially remove this option
-	if (!ps->o.vsync_aggressive)
+	if (!ps->o.vsync_aggressive) {
 		vsync_wait(ps);
+		paint_lap(ps, FRAME_STAGE_VSYNC, &lap);
+	}
 
-	switch (ps->o.backend) {
-	case BKEND_XRENDER:
-		if (ps->o.monitor_repaint) {
-			// Copy the screen content to a new picture, and highlight the
-			// paint region. This is not very efficient, but since it's for
-			// debug only, we don't really care
-
-			// First we create a new picture, and copy content from the buffer
-			// to it
-			auto pictfmt = x_get_pictform_for_visual(ps->c, ps->vis);
-			xcb_render_picture_t new_pict = x_create_picture_with_pictfmt(
-			    ps, ps->root_width, ps->root_height, pictfmt, 0, NULL);
-			xcb_render_composite(ps->c, XCB_RENDER_PICT_OP_SRC,
-			                     ps->tgt_buffer.pict, XCB_NONE, new_pict, 0, 0,
-			                     0, 0, 0, 0, ps->root_width, ps->root_height);
-
-			// Next, we set the region of paint and highlight it
-			x_set_picture_clip_region(ps->c, new_pict, 0, 0, &region);
-			xcb_render_composite(ps->c, XCB_RENDER_PICT_OP_OVER, ps->white_picture,
-			                     ps->alpha_picts[MAX_ALPHA / 2], new_pict, 0, 0,
-			                     0, 0, 0, 0, ps->root_width, ps->root_height);
-
-			// Finally, clear clip regions of new_pict and the screen, and put
-			// the whole thing on screen
-			x_set_picture_clip_region(ps->c, new_pict, 0, 0, &ps->screen_reg);
-			x_set_picture_clip_region(ps->c, ps->tgt_picture, 0, 0, &ps->screen_reg);
-			xcb_render_composite(ps->c, XCB_RENDER_PICT_OP_SRC, new_pict,
-			                     XCB_NONE, ps->tgt_picture, 0, 0, 0, 0, 0, 0,
-			                     ps->root_width, ps->root_height);
-			xcb_render_free_picture(ps->c, new_pict);
-		} else
-			xcb_render_composite(ps->c, XCB_RENDER_PICT_OP_SRC, ps->tgt_buffer.pict,
-			                     XCB_NONE, ps->tgt_picture, 0, 0, 0, 0, 0, 0,
-			                     ps->root_width, ps->root_height);
-		break;
-#ifdef CONFIG_OPENGL
-	case BKEND_XR_GLX_HYBRID:
-		x_sync(ps->c);
-		if (ps->o.vsync_use_glfinish)
-			glFinish();
-		else
-			glFlush();
-		glXWaitX();
-		assert(ps->tgt_buffer.pixmap);
-		paint_bind_tex(ps, &ps->tgt_buffer, ps->root_width, ps->root_height, false,
-		               ps->depth, ps->vis, !ps->o.glx_no_rebind_pixmap);
-		if (ps->o.vsync_use_glfinish)
-			glFinish();
-		else
-			glFlush();
-		glXWaitX();
-		glx_render(ps, ps->tgt_buffer.ptex, 0, 0, 0, 0, ps->root_width,
-		           ps->root_height, 0, 1.0, false, false, &region, NULL);
-		// falls through
-	case BKEND_GLX: glXSwapBuffers(ps->dpy, get_tgt_window(ps)); break;
-#endif
-	default: assert(0);
+	if (vsync_is_async(ps)) {
+		// Shown from the vblank event
+		vsync_queue_frame(ps, &region);
+	} else {
+		paint_commit(ps, &region);
 	}
+	paint_lap(ps, FRAME_STAGE_PRESENT, &lap);
 
-	if (ps->o.vsync_aggressive)
+	if (ps->o.vsync_aggressive) {
 		vsync_wait(ps);
+		paint_lap(ps, FRAME_STAGE_VSYNC, &lap);
+	}
 
 	x_sync(ps->c);
 
@@ -1047,6 +1149,15 @@ void paint_all(session_t *ps, win *const t, bool ignore_damage) {
 		glXWaitX();
 	}
 #endif
+	paint_lap(ps, FRAME_STAGE_XSYNC, &lap);
+	frame_timing_painted(timing);
+
+	// Otherwise the frame is shown by a later vblank or Present event
+	if (!vsync_is_async(ps) && ps->o.vsync != VSYNC_PRESENT) {
+		long now = pacing_now();
+		latency_frame_shown(ps->latency, now);
+		frame_timing_shown(timing, now, ps->refresh_intv);
+	}
 
 #ifdef DEBUG_REPAINT
 	struct timespec now = get_time_timespec();
@@ -1127,6 +1238,7 @@ bool init_render(session_t *ps) {
 #ifdef CONFIG_OPENGL
 		if (!glx_init(ps, true))
 			return false;
+		gl_program_cache_init(!ps->o.glx_no_program_cache);
 #else
 		log_error("GLX backend support not compiled in.");
 		return false;
@@ -1170,6 +1282,10 @@ bool init_render(session_t *ps) {
 			return false;
 	}
 
+#ifdef CONFIG_OPENGL
+	gl_program_cache_report();
+#endif
+
 	ps->gaussian_map = gaussian_kernel(ps->o.shadow_radius);
 	shadow_preprocess(ps->gaussian_map);
 
@@ -1194,13 +1310,7 @@ bool init_render(session_t *ps) {
 		}
 	}
 
-	ps->ndamage = maximum_buffer_age(ps);
-	ps->damage_ring = ccalloc(ps->ndamage, region_t);
-	ps->damage = ps->damage_ring + ps->ndamage - 1;
-
-	for (int i = 0; i < ps->ndamage; i++) {
-		pixman_region32_init(&ps->damage_ring[i]);
-	}
+	damage_history_init(&ps->damage, maximum_buffer_age(ps));
 	return true;
 }
 
@@ -1222,6 +1332,218 @@ void free_root_tile(session_t *ps) {
 	ps->root_tile_fill = false;
 }
 
+/// Size of a 32-bit image, in bytes.
+static inline size_t image_bytes(int width, int height) {
+	return (size_t)max_i(width, 0) * (size_t)max_i(height, 0) * 4;
+}
+
+const char *const RENDER_RES_NAMES[NUM_RENDER_RES] = {
+    "pixmap", "glx_pixmap", "shadow", "blur", "root", "target",
+};
+
+void render_win_resource_bytes(session_t *ps, win *w, size_t bytes[NUM_RENDER_RES]) {
+	memset(bytes, 0, NUM_RENDER_RES * sizeof(size_t));
+	if (w->paint.pixmap)
+		bytes[RENDER_RES_PIXMAP] = image_bytes(w->widthb, w->heightb);
+	if (w->paint.ptex)
+		bytes[RENDER_RES_GLX_PIXMAP] =
+		    image_bytes((int)w->paint.ptex->width, (int)w->paint.ptex->height);
+	if (w->shadow_paint.pixmap)
+		bytes[RENDER_RES_SHADOW] = image_bytes(w->shadow_width, w->shadow_height);
+#ifdef CONFIG_OPENGL
+	// Two textures to blur back and forth between
+	bytes[RENDER_RES_BLUR] =
+	    2 * image_bytes(w->glx_blur_cache.width, w->glx_blur_cache.height);
+#endif
+}
+
+void render_resource_usage(session_t *ps, size_t bytes[NUM_RENDER_RES]) {
+	memset(bytes, 0, NUM_RENDER_RES * sizeof(size_t));
+	for (win *w = ps->list; w; w = w->next) {
+		size_t wbytes[NUM_RENDER_RES];
+		render_win_resource_bytes(ps, w, wbytes);
+		for (int i = 0; i < NUM_RENDER_RES; i++)
+			bytes[i] += wbytes[i];
+	}
+
+	if (ps->root_tile_fill || ps->root_tile_paint.ptex)
+		bytes[RENDER_RES_ROOT] = image_bytes(ps->root_width, ps->root_height);
+	if (ps->o.vsync == VSYNC_PRESENT) {
+		for (int i = 0; i < PRESENT_NBUFFERS; i++)
+			if (ps->present_bufs[i].paint.pixmap)
+				bytes[RENDER_RES_TARGET] += image_bytes(
+				    ps->present_bufs[i].width, ps->present_bufs[i].height);
+	} else if (ps->tgt_buffer.pixmap) {
+		bytes[RENDER_RES_TARGET] = image_bytes(ps->root_width, ps->root_height);
+	}
+#ifdef CONFIG_OPENGL
+	if (ps->psglx && ps->psglx->kawase_blur)
+		bytes[RENDER_RES_BLUR] += gl_kawase_blur_texture_bytes(ps->psglx->kawase_blur);
+#endif
+}
+
+size_t render_resource_total(const size_t bytes[NUM_RENDER_RES]) {
+	size_t ret = 0;
+	for (int i = 0; i < NUM_RENDER_RES; i++)
+		// Counting texture from pixmap again would count most windows twice
+		if (i != RENDER_RES_GLX_PIXMAP)
+			ret += bytes[i];
+	return ret;
+}
+
+size_t render_resource_bytes(session_t *ps) {
+	size_t bytes[NUM_RENDER_RES];
+	render_resource_usage(ps, bytes);
+	return render_resource_total(bytes);
+}
+
+/// A resource that can be freed to stay within the budget.
+struct render_eviction {
+	/// The window it belongs to, NULL for the shared blur textures
+	win *w;
+	enum render_resource kind;
+	size_t bytes;
+	/// Whether the next frame needs it
+	bool in_use;
+};
+
+static int render_eviction_cmp(const void *a, const void *b) {
+	const struct render_eviction *x = a, *y = b;
+	if (x->in_use != y->in_use)
+		return x->in_use ? 1 : -1;
+	return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+size_t render_evict_resources(session_t *ps, size_t budget) {
+	size_t held = render_resource_bytes(ps);
+	if (held <= budget)
+		return 0;
+
+	int n = 0;
+	for (win *w = ps->list; w; w = w->next)
+		n++;
+	auto ev = ccalloc(3 * n + 1, struct render_eviction);
+	n = 0;
+	for (win *w = ps->list; w; w = w->next) {
+		size_t bytes[NUM_RENDER_RES];
+		render_win_resource_bytes(ps, w, bytes);
+		// Pixmaps of windows fading out can't be named again, and those
+		// of windows being painted would be named again right away. The
+		// texture goes with the pixmap, but isn't counted in `held`.
+		size_t pixmap = bytes[RENDER_RES_PIXMAP];
+		if (pixmap && !w->to_paint && !w->destroying &&
+		    w->a.map_state == XCB_MAP_STATE_VIEWABLE)
+			ev[n++] = (struct render_eviction){w, RENDER_RES_PIXMAP, pixmap, false};
+		if (bytes[RENDER_RES_SHADOW])
+			ev[n++] = (struct render_eviction){
+			    w, RENDER_RES_SHADOW, bytes[RENDER_RES_SHADOW], w->to_paint};
+		if (bytes[RENDER_RES_BLUR])
+			ev[n++] = (struct render_eviction){
+			    w, RENDER_RES_BLUR, bytes[RENDER_RES_BLUR], w->to_paint};
+	}
+#ifdef CONFIG_OPENGL
+	if (ps->psglx && ps->psglx->kawase_blur) {
+		size_t bytes = gl_kawase_blur_texture_bytes(ps->psglx->kawase_blur);
+		if (bytes)
+			ev[n++] = (struct render_eviction){NULL, RENDER_RES_BLUR, bytes, true};
+	}
+#endif
+	qsort(ev, (size_t)n, sizeof(*ev), render_eviction_cmp);
+
+	size_t freed = 0;
+	for (int i = 0; i < n && held - freed > budget; i++) {
+		win *w = ev[i].w;
+		switch (ev[i].kind) {
+		case RENDER_RES_PIXMAP: free_paint(ps, &w->paint); break;
+		case RENDER_RES_SHADOW: free_paint(ps, &w->shadow_paint); break;
+		case RENDER_RES_BLUR:
+#ifdef CONFIG_OPENGL
+			if (w)
+				free_glx_bc(ps, &w->glx_blur_cache);
+			else
+				gl_kawase_blur_release(ps->psglx->kawase_blur);
+#endif
+			break;
+		default: assert(false);
+		}
+		freed += ev[i].bytes;
+		log_trace("Evicted %zu KiB of %s of window %#010x.", ev[i].bytes / 1024,
+		          RENDER_RES_NAMES[ev[i].kind], w ? w->id : 0);
+	}
+	free(ev);
+	return freed;
+}
+
+static int render_win_bytes_cmp(const void *a, const void *b) {
+	size_t x = ((const size_t *)a)[NUM_RENDER_RES],
+	       y = ((const size_t *)b)[NUM_RENDER_RES];
+	return (x < y) - (x > y);
+}
+
+char *render_resource_report(session_t *ps) {
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f = open_memstream(&buf, &len);
+	if (!f)
+		return NULL;
+
+	size_t bytes[NUM_RENDER_RES];
+	render_resource_usage(ps, bytes);
+	fprintf(f, "total\t%zu\n", render_resource_total(bytes));
+	for (int i = 0; i < NUM_RENDER_RES; i++)
+		fprintf(f, "%s\t%zu\n", RENDER_RES_NAMES[i], bytes[i]);
+
+	// For each window, its bytes by kind, its total, and its id
+	int n = 0;
+	for (win *w = ps->list; w; w = w->next)
+		n++;
+	const int stride = NUM_RENDER_RES + 2;
+	auto wins = ccalloc(stride * n + 1, size_t);
+	n = 0;
+	for (win *w = ps->list; w; w = w->next) {
+		size_t *row = &wins[stride * n];
+		render_win_resource_bytes(ps, w, row);
+		row[NUM_RENDER_RES] = render_resource_total(row);
+		row[NUM_RENDER_RES + 1] = w->id;
+		if (row[NUM_RENDER_RES] || row[RENDER_RES_GLX_PIXMAP])
+			n++;
+	}
+	qsort(wins, (size_t)n, stride * sizeof(size_t), render_win_bytes_cmp);
+	for (int i = 0; i < n; i++) {
+		const size_t *row = &wins[stride * i];
+		fprintf(f, "window:%#010zx\t%zu", row[NUM_RENDER_RES + 1], row[NUM_RENDER_RES]);
+		for (int j = RENDER_RES_PIXMAP; j <= RENDER_RES_BLUR; j++)
+			fprintf(f, "\t%zu", row[j]);
+		fputc('\n', f);
+	}
+	free(wins);
+
+	fclose(f);
+	return buf;
+}
+
+void pause_render(session_t *ps) {
+	for (win *w = ps->list; w; w = w->next) {
+		// Pixmaps of windows fading out can't be named again
+		if (w->a.map_state == XCB_MAP_STATE_VIEWABLE && !w->destroying)
+			free_paint(ps, &w->paint);
+		free_paint(ps, &w->shadow_paint);
+#ifdef CONFIG_OPENGL
+		free_glx_bc(ps, &w->glx_blur_cache);
+#endif
+	}
+
+	free_root_tile(ps);
+	if (ps->o.vsync == VSYNC_PRESENT)
+		present_release_buffers(ps);
+	else
+		free_paint(ps, &ps->tgt_buffer);
+#ifdef CONFIG_OPENGL
+	if (ps->psglx && ps->psglx->kawase_blur)
+		gl_kawase_blur_release(ps->psglx->kawase_blur);
+#endif
+}
+
 void deinit_render(session_t *ps) {
 	// Free alpha_picts
 	for (int i = 0; i <= MAX_ALPHA; ++i)
@@ -1242,16 +1564,17 @@ void deinit_render(session_t *ps) {
 	// Free other X resources
 	free_root_tile(ps);
 
+	if (ps->o.vsync == VSYNC_PRESENT) {
+		present_deinit(ps);
+	}
+
 	// Free the damage ring
-	for (int i = 0; i < ps->ndamage; ++i)
-		pixman_region32_fini(&ps->damage_ring[i]);
-	ps->ndamage = 0;
-	free(ps->damage_ring);
-	ps->damage_ring = ps->damage = NULL;
+	damage_history_deinit(&ps->damage);
 
 #ifdef CONFIG_OPENGL
 	free(ps->root_tile_paint.fbcfg);
 	glx_destroy(ps);
+	gl_program_cache_deinit();
 #endif
 }
 
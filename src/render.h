@@ -35,10 +35,58 @@ paint_one(session_t *ps, win *w, const region_t *reg_paint);
 void
 paint_all(session_t *ps, win * const t, bool ignore_damage);
 
+void paint_commit(session_t *ps, const region_t *region);
+
 void free_picture(xcb_connection_t *c, xcb_render_picture_t *p);
 
 void free_paint(session_t *ps, paint_t *ppaint);
 void free_root_tile(session_t *ps);
 
+/// Kinds of painting resources, for accounting.
+enum render_resource {
+  /// Window pixmaps named with the Composite extension
+  RENDER_RES_PIXMAP,
+  /// GLX pixmaps and textures bound to window pixmaps, which may share
+  /// memory with the pixmaps. Only informational, left out of totals.
+  RENDER_RES_GLX_PIXMAP,
+  /// Shadow pixmaps, pictures and textures
+  RENDER_RES_SHADOW,
+  /// Blur textures and framebuffers
+  RENDER_RES_BLUR,
+  /// The root tile
+  RENDER_RES_ROOT,
+  /// Back buffers
+  RENDER_RES_TARGET,
+  NUM_RENDER_RES,
+};
+
+extern const char *const RENDER_RES_NAMES[NUM_RENDER_RES];
+
+/// Free painting resources that are rebuilt when painting resumes.
+void pause_render(session_t *ps);
+/// Estimated size of the painting resources held for `w`, in bytes, by kind.
+void render_win_resource_bytes(session_t *ps, win *w, size_t bytes[NUM_RENDER_RES]);
+/// Estimated size of all the painting resources we hold, in bytes, by kind.
+void render_resource_usage(session_t *ps, size_t bytes[NUM_RENDER_RES]);
+/// Total of sizes by kind, without those only given for information.
+size_t render_resource_total(const size_t bytes[NUM_RENDER_RES]);
+/// Estimated size of the painting resources we hold, in bytes.
+size_t render_resource_bytes(session_t *ps);
+/// Free the largest painting resources that are rebuilt when needed, until
+/// at most `budget` bytes are held. Those not needed by the next frame go
+/// first.
+///
+/// @return the number of bytes freed
+size_t render_evict_resources(session_t *ps, size_t budget);
+/// Get a report of the painting resources we hold, which has to be freed.
+///
+/// Each line has a key, then tab separated sizes in bytes:
+///   total  all resources, as render_resource_total() counts them
+///   <kind>  all resources of a kind, for each kind in RENDER_RES_NAMES
+///   window:<id>  total, pixmap, glx_pixmap, shadow, blur
+/// Windows holding nothing are left out, the others are sorted by their
+/// total, largest first.
+char *render_resource_report(session_t *ps);
+
 bool init_render(session_t *ps);
 void deinit_render(session_t *ps);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+#include "roundtrip.h"
+
+struct round_trip_stats round_trips;
+
+void round_trip_done(struct round_trip_site *site, long start) {
+	long us = pacing_now() - start;
+	if (!site->count) {
+		site->next = round_trips.sites;
+		round_trips.sites = site;
+	}
+	site->count++;
+	site->total_us += us;
+	site->max_us = max_l(site->max_us, us);
+	round_trips.count++;
+	round_trips.total_us += us;
+
+	switch (round_trips.cause) {
+	case ROUND_TRIP_CAUSE_FRAME:
+		site->frame_count++;
+		round_trips.frame_count++;
+		round_trips.frame_us += us;
+		round_trips.frame_current++;
+		break;
+	case ROUND_TRIP_CAUSE_EVENT: {
+		auto e = &round_trips.events[round_trips.event];
+		site->event_count++;
+		e->count++;
+		e->total_us += us;
+		break;
+	}
+	case ROUND_TRIP_CAUSE_OTHER: break;
+	}
+}
+
+void round_trip_end(void) {
+	if (round_trips.cause == ROUND_TRIP_CAUSE_FRAME) {
+		round_trips.frame_last = round_trips.frame_current;
+		if (round_trips.frame_current > round_trips.frame_max)
+			round_trips.frame_max = round_trips.frame_current;
+	}
+	round_trips.cause = ROUND_TRIP_CAUSE_OTHER;
+}
+
+static int round_trip_site_cmp(const void *a, const void *b) {
+	long x = (*(struct round_trip_site *const *)a)->total_us,
+	     y = (*(struct round_trip_site *const *)b)->total_us;
+	return (x < y) - (x > y);
+}
+
+char *round_trip_report(session_t *ps, const char *(*event_name)(session_t *ps, int type)) {
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f = open_memstream(&buf, &len);
+	if (!f)
+		return NULL;
+
+	fprintf(f, "total\t%lu\t%ld\n", round_trips.count, round_trips.total_us);
+	fprintf(f, "frame\t%lu\t%ld\t%lu\t%lu\n", round_trips.frame_count,
+	        round_trips.frame_us, round_trips.frame_last, round_trips.frame_max);
+	for (int i = 0; i < ROUND_TRIP_NEVENTS; i++) {
+		auto e = &round_trips.events[i];
+		if (e->count)
+			fprintf(f, "event:%s\t%lu\t%ld\n", event_name(ps, i), e->count,
+			        e->total_us);
+	}
+
+	int nsites = 0;
+	for (auto s = round_trips.sites; s; s = s->next)
+		nsites++;
+	auto sites = ccalloc(nsites + 1, struct round_trip_site *);
+	nsites = 0;
+	for (auto s = round_trips.sites; s; s = s->next)
+		sites[nsites++] = s;
+	qsort(sites, (size_t)nsites, sizeof(*sites), round_trip_site_cmp);
+	for (int i = 0; i < nsites; i++)
+		fprintf(f, "site:%s:%s\t%lu\t%ld\t%ld\t%lu\t%lu\n", sites[i]->func,
+		        sites[i]->what, sites[i]->count, sites[i]->total_us,
+		        sites[i]->max_us, sites[i]->frame_count, sites[i]->event_count);
+	free(sites);
+
+	fclose(f);
+	return buf;
+}
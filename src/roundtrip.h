@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+
+#include "pacing.h"
+
+typedef struct session session_t;
+
+/// Accounting of round trips to the X server.
+///
+/// compton stalls for a round trip every time it waits for the reply to a
+/// request. The places that do are wrapped in X_ROUND_TRIP(), which counts and
+/// times them by call site, and by what they were made for: handling an X
+/// event, painting a frame, or anything else, like startup and D-Bus calls.
+
+/// Number of X event types, extension events included.
+#define ROUND_TRIP_NEVENTS 128
+
+enum round_trip_cause {
+	ROUND_TRIP_CAUSE_OTHER,
+	/// Painting a frame
+	ROUND_TRIP_CAUSE_FRAME,
+	/// Handling an X event
+	ROUND_TRIP_CAUSE_EVENT,
+};
+
+/// A place round trips are made from.
+struct round_trip_site {
+	/// Function the round trip is made in.
+	const char *func;
+	/// What is waited for.
+	const char *what;
+	unsigned long count;
+	/// Number made painting frames, and handling events.
+	unsigned long frame_count, event_count;
+	/// Total and longest time waited, in microseconds.
+	long total_us, max_us;
+	/// Next site, in the order they were first used.
+	struct round_trip_site *next;
+};
+
+struct round_trip_stats {
+	unsigned long count;
+	/// Total time waited, in microseconds.
+	long total_us;
+	/// What round trips are being made for.
+	enum round_trip_cause cause;
+	/// Type of the event being handled.
+	int event;
+	/// Round trips made for each type of event.
+	struct {
+		unsigned long count;
+		long total_us;
+	} events[ROUND_TRIP_NEVENTS];
+	/// Round trips made painting frames.
+	unsigned long frame_count;
+	long frame_us;
+	/// Round trips made painting the current frame, the last one, and the
+	/// most made by one frame.
+	unsigned long frame_current, frame_last, frame_max;
+	/// Every site used so far.
+	struct round_trip_site *sites;
+};
+
+extern struct round_trip_stats round_trips;
+
+/// Account a round trip made from `site`, which started at `start`.
+void round_trip_done(struct round_trip_site *site, long start);
+
+/// Make a round trip by evaluating `expr`, and account it. `what` names the
+/// request waited for, the call site is the function this is used in.
+#define X_ROUND_TRIP(what_, expr)                                                        \
+	({                                                                               \
+		static struct round_trip_site round_trip_site_ = {                       \
+		    .func = __func__, .what = what_};                                    \
+		long round_trip_start_ = pacing_now();                                   \
+		__auto_type round_trip_ret_ = (expr);                                    \
+		round_trip_done(&round_trip_site_, round_trip_start_);                   \
+		round_trip_ret_;                                                         \
+	})
+
+/// Same as X_ROUND_TRIP(), for an `expr` without a value.
+#define X_ROUND_TRIP_VOID(what_, expr)                                                   \
+	({                                                                               \
+		static struct round_trip_site round_trip_site_ = {                       \
+		    .func = __func__, .what = what_};                                    \
+		long round_trip_start_ = pacing_now();                                   \
+		(expr);                                                                  \
+		round_trip_done(&round_trip_site_, round_trip_start_);                   \
+	})
+
+/// Account the following round trips to handling an event of `type`.
+static inline void round_trip_event_begin(int type) {
+	round_trips.cause = ROUND_TRIP_CAUSE_EVENT;
+	round_trips.event = type & (ROUND_TRIP_NEVENTS - 1);
+}
+
+/// Account the following round trips to painting a frame.
+static inline void round_trip_frame_begin(void) {
+	round_trips.cause = ROUND_TRIP_CAUSE_FRAME;
+	round_trips.frame_current = 0;
+}
+
+/// Stop accounting round trips to an event or frame.
+void round_trip_end(void);
+
+/// Get a report of the round trips made, which has to be freed. Event types
+/// are named by `event_name`.
+///
+/// Each line has a key, then tab separated numbers:
+///   total  count, microseconds
+///   frame  count, microseconds, count in the last frame, most in one frame
+///   event:<name>  count, microseconds
+///   site:<function>:<request>  count, microseconds, longest, count made
+///                              painting frames, count made handling events
+/// Sites are sorted by the time spent in them, longest first.
+char *round_trip_report(session_t *ps, const char *(*event_name)(session_t *ps, int type));
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "pacing.h"
+#include "probe.h"
+#include "utils.h"
+
+#include "timing.h"
+
+const char *const FRAME_STAGE_NAMES[NUM_FRAME_STAGES] = {
+    [FRAME_STAGE_EVENTS] = "events",
+    [FRAME_STAGE_PREPROCESS] = "preprocess",
+    [FRAME_STAGE_REGION] = "region",
+    [FRAME_STAGE_ROOT] = "root",
+    [FRAME_STAGE_SHADOW] = "shadow",
+    [FRAME_STAGE_BLUR] = "blur",
+    [FRAME_STAGE_COMPOSITE] = "composite",
+    [FRAME_STAGE_VSYNC] = "vsync",
+    [FRAME_STAGE_PRESENT] = "present",
+    [FRAME_STAGE_XSYNC] = "xsync",
+};
+
+// Fine around the usual refresh intervals, 60Hz at 16667 and 30Hz at 33333
+const long FRAME_HIST_BOUNDS[FRAME_HIST_NBUCKETS] = {
+    500, 1000, 2000, 4000, 8000, 12000, 16667, 20000, 25000, 33333, 50000, 100000,
+    0,
+};
+
+static void frame_histogram_add(struct frame_histogram *h, long us) {
+	int i = 0;
+	while (i < FRAME_HIST_NBUCKETS - 1 && us > FRAME_HIST_BOUNDS[i])
+		i++;
+	h->buckets[i]++;
+	h->count++;
+	h->sum += us;
+}
+
+void frame_timing_begin(struct frame_timing *t, long now) {
+	t->frame_start = now;
+	memset(t->windows, 0, sizeof(t->windows));
+}
+
+void frame_timing_window(struct frame_timing *t, uint32_t id, long us) {
+	// Keep the windows sorted, costliest first
+	int i = FRAME_TIMING_NWINDOWS;
+	while (i > 0 && t->windows[i - 1].us < us) {
+		if (i < FRAME_TIMING_NWINDOWS)
+			t->windows[i] = t->windows[i - 1];
+		i--;
+	}
+	if (i < FRAME_TIMING_NWINDOWS)
+		t->windows[i] = (struct frame_window){.id = id, .us = us};
+}
+
+void frame_timing_painted(struct frame_timing *t) {
+	t->painted = true;
+	t->pending_start = t->frame_start;
+	memcpy(t->pending_stages, t->current, sizeof(t->current));
+	memcpy(t->pending_windows, t->windows, sizeof(t->windows));
+
+	// Events are handled before the frame starts, and waiting for vblank
+	// isn't work
+	long render = 0;
+	for (int i = 0; i < NUM_FRAME_STAGES; i++)
+		if (i != FRAME_STAGE_EVENTS && i != FRAME_STAGE_VSYNC)
+			render += t->current[i];
+	frame_histogram_add(&t->render, render);
+}
+
+static void frame_timing_log_miss(const struct frame_timing *t, long duration,
+                                  long vblanks, long refresh_intv) {
+	// Waiting for vblank is what missing one looks like, not why it's missed
+	int dominant = FRAME_STAGE_PREPROCESS;
+	for (int i = FRAME_STAGE_PREPROCESS; i < NUM_FRAME_STAGES; i++)
+		if (i != FRAME_STAGE_VSYNC &&
+		    t->pending_stages[i] > t->pending_stages[dominant])
+			dominant = i;
+
+	char windows[128] = " none";
+	int len = 0;
+	for (int i = 0; i < FRAME_TIMING_NWINDOWS && t->pending_windows[i].id; i++)
+		len += snprintf(windows + len, sizeof(windows) - (size_t)len,
+		                " %#010x (%ld us)", t->pending_windows[i].id,
+		                t->pending_windows[i].us);
+
+	log_warn("A frame missed %ld vblank(s), it was shown %ld us after it started "
+	         "with a refresh interval of %ld us. Most of it was spent in %s "
+	         "(%ld us), the costliest windows were:%s. %lu frame(s) missed "
+	         "vblanks since the last warning.",
+	         vblanks, duration, refresh_intv, FRAME_STAGE_NAMES[dominant],
+	         t->pending_stages[dominant], windows, t->missed_unlogged);
+}
+
+void frame_timing_shown(struct frame_timing *t, long when, long refresh_intv) {
+	long start = t->pending_start;
+	if (!start)
+		return;
+	t->pending_start = 0;
+
+	if (t->last_shown && start - t->last_shown < FRAME_IDLE_US &&
+	    when > t->last_shown)
+		frame_histogram_add(&t->intervals, when - t->last_shown);
+	t->last_shown = when;
+
+	// A frame on time is shown by the first vblank after it started. Allow
+	// an eighth of a refresh interval for timestamps taken after the vblank.
+	if (!refresh_intv)
+		return;
+	long vblanks = (when - start - refresh_intv / 8) / refresh_intv;
+	if (vblanks < 1)
+		return;
+	t->missed++;
+	t->missed_vblanks += (unsigned long)vblanks;
+	t->missed_unlogged++;
+
+	if (t->last_miss_log && when - t->last_miss_log < FRAME_MISS_LOG_INTERVAL_US)
+		return;
+	t->last_miss_log = when;
+	frame_timing_log_miss(t, when - start, vblanks, refresh_intv);
+	t->missed_unlogged = 0;
+}
+
+static void frame_histogram_print(FILE *f, const char *name,
+                                  const struct frame_histogram *h) {
+	fprintf(f, "%s\t%lu\t%ld", name, h->count, h->sum);
+	for (int i = 0; i < FRAME_HIST_NBUCKETS; i++)
+		fprintf(f, "\t%lu", h->buckets[i]);
+	fputc('\n', f);
+}
+
+char *frame_timing_histogram_report(const struct frame_timing *t) {
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f = open_memstream(&buf, &len);
+	if (!f)
+		return NULL;
+
+	fputs("bounds", f);
+	for (int i = 0; i < FRAME_HIST_NBUCKETS - 1; i++)
+		fprintf(f, "\t%ld", FRAME_HIST_BOUNDS[i]);
+	fputc('\n', f);
+	frame_histogram_print(f, "interval", &t->intervals);
+	frame_histogram_print(f, "render", &t->render);
+	fprintf(f, "missed\t%lu\t%lu\n", t->missed, t->missed_vblanks);
+
+	fclose(f);
+	return buf;
+}
+
+void frame_timing_lap(struct frame_timing *t, enum frame_stage stage, long *lap) {
+	long now = pacing_now();
+	t->current[stage] += now - *lap;
+	PROBE(frame_stage, stage, now - *lap);
+	*lap = now;
+}
+
+enum frame_stage frame_stage_from_name(const char *name) {
+	for (int i = 0; i < NUM_FRAME_STAGES; i++)
+		if (!strcmp(FRAME_STAGE_NAMES[i], name))
+			return i;
+	return NUM_FRAME_STAGES;
+}
+
+long frame_timing_avg(const struct frame_timing *t, enum frame_stage stage) {
+	if (!t->nsamples)
+		return 0;
+	long sum = 0;
+	for (int i = 0; i < t->nsamples; i++)
+		sum += t->samples[stage][i];
+	return sum / t->nsamples;
+}
+
+long frame_timing_max(const struct frame_timing *t, enum frame_stage stage) {
+	long ret = 0;
+	for (int i = 0; i < t->nsamples; i++)
+		ret = max_l(ret, t->samples[stage][i]);
+	return ret;
+}
+
+long frame_timing_last(const struct frame_timing *t, enum frame_stage stage) {
+	if (!t->nsamples)
+		return 0;
+	int last = (t->next_sample + FRAME_TIMING_NSAMPLES - 1) % FRAME_TIMING_NSAMPLES;
+	return t->samples[stage][last];
+}
+
+static void frame_timing_log(const struct frame_timing *t) {
+	char buf[512];
+	int len = 0;
+	for (int i = 0; i < NUM_FRAME_STAGES && len < (int)sizeof(buf); i++)
+		len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %s %ld/%ld",
+		                FRAME_STAGE_NAMES[i], frame_timing_avg(t, i),
+		                frame_timing_max(t, i));
+	log_info("Frame timing over %d frames, average/max in us:%s", t->nsamples, buf);
+}
+
+void frame_timing_end(struct frame_timing *t, long now, unsigned long log_interval) {
+	if (!t->painted)
+		return;
+	t->painted = false;
+
+	for (int i = 0; i < NUM_FRAME_STAGES; i++)
+		t->samples[i][t->next_sample] = t->current[i];
+	t->next_sample = (t->next_sample + 1) % FRAME_TIMING_NSAMPLES;
+	t->nsamples = min_i(t->nsamples + 1, FRAME_TIMING_NSAMPLES);
+	memset(t->current, 0, sizeof(t->current));
+	t->frames++;
+
+	if (!log_interval)
+		return;
+	if (!t->last_log) {
+		t->last_log = now;
+	} else if (now - t->last_log >= (long)log_interval * 1000000L) {
+		t->last_log = now;
+		frame_timing_log(t);
+	}
+}
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Time spent in each stage of recent frames.
+///
+/// Stages are timed by laps: the time since the end of the previous lap is
+/// added to the stage given, so consecutive stages take one clock read each.
+
+/// Number of recent frames kept.
+#define FRAME_TIMING_NSAMPLES 128
+
+/// Number of buckets of the frame histograms.
+#define FRAME_HIST_NBUCKETS 13
+
+/// Number of the costliest windows of a frame remembered.
+#define FRAME_TIMING_NWINDOWS 3
+
+/// Frames starting longer than this after the previous one was shown, in
+/// microseconds, follow an idle screen. Their interval is not counted.
+#define FRAME_IDLE_US 100000L
+
+/// Shortest interval between warnings about missed vblanks, in microseconds.
+#define FRAME_MISS_LOG_INTERVAL_US 10000000L
+
+enum frame_stage {
+	/// Handling X events, since the last frame
+	FRAME_STAGE_EVENTS,
+	/// paint_preprocess()
+	FRAME_STAGE_PREPROCESS,
+	/// Computing paint regions, and preparing the back buffer
+	FRAME_STAGE_REGION,
+	/// Painting the root window
+	FRAME_STAGE_ROOT,
+	/// Building and painting shadows
+	FRAME_STAGE_SHADOW,
+	/// Blurring window backgrounds
+	FRAME_STAGE_BLUR,
+	/// Painting windows
+	FRAME_STAGE_COMPOSITE,
+	/// Waiting for vblank
+	FRAME_STAGE_VSYNC,
+	/// Putting the frame on screen
+	FRAME_STAGE_PRESENT,
+	/// Waiting for the X server and OpenGL to finish
+	FRAME_STAGE_XSYNC,
+	NUM_FRAME_STAGES,
+};
+
+extern const char *const FRAME_STAGE_NAMES[NUM_FRAME_STAGES];
+
+/// Upper bounds of the histogram buckets, in microseconds. The last one has
+/// no bound.
+extern const long FRAME_HIST_BOUNDS[FRAME_HIST_NBUCKETS];
+
+/// A histogram of durations, cumulative since compton started.
+struct frame_histogram {
+	unsigned long buckets[FRAME_HIST_NBUCKETS];
+	unsigned long count;
+	/// Sum of the durations, in microseconds.
+	long sum;
+};
+
+/// Time a window took to paint in a frame.
+struct frame_window {
+	uint32_t id;
+	long us;
+};
+
+struct frame_timing {
+	/// Time spent in each stage by recent frames, in microseconds.
+	long samples[NUM_FRAME_STAGES][FRAME_TIMING_NSAMPLES];
+	/// Number of valid samples.
+	int nsamples;
+	/// Where the next sample is stored.
+	int next_sample;
+	/// Time spent in each stage since the last painted frame.
+	long current[NUM_FRAME_STAGES];
+	/// Whether a frame has been painted since the last frame_timing_end().
+	bool painted;
+	/// Number of frames painted.
+	unsigned long frames;
+	/// When the last summary was logged.
+	long last_log;
+
+	/// When the frame being painted started.
+	long frame_start;
+	/// The costliest windows of the frame being painted, costliest first.
+	struct frame_window windows[FRAME_TIMING_NWINDOWS];
+
+	/// When the frame painted but not shown yet started, 0 if none.
+	long pending_start;
+	/// Stage times and costliest windows of that frame.
+	long pending_stages[NUM_FRAME_STAGES];
+	struct frame_window pending_windows[FRAME_TIMING_NWINDOWS];
+	/// When the last frame was shown.
+	long last_shown;
+
+	/// Time between frames being shown, while the screen is busy.
+	struct frame_histogram intervals;
+	/// Time spent painting frames, not counting waiting for vblank.
+	struct frame_histogram render;
+	/// Number of frames shown later than the first vblank after they
+	/// started, and the number of vblanks they missed in total.
+	unsigned long missed, missed_vblanks;
+	/// Missed frames not warned about, and when the last warning was.
+	unsigned long missed_unlogged;
+	long last_miss_log;
+};
+
+/// Start painting a frame.
+void frame_timing_begin(struct frame_timing *, long now);
+
+/// Record the time window `id` took to paint in the current frame.
+void frame_timing_window(struct frame_timing *, uint32_t id, long us);
+
+/// Record that the current frame has been painted. It is shown by
+/// frame_timing_shown().
+void frame_timing_painted(struct frame_timing *);
+
+/// Record that the frame painted last is shown at `when`, and check it
+/// against the refresh interval, if it is known.
+void frame_timing_shown(struct frame_timing *, long when, long refresh_intv);
+
+/// Get a report of the frame histograms, free()'d by the caller.
+char *frame_timing_histogram_report(const struct frame_timing *);
+
+/// Add the time since `*lap` to `stage`, and start the next lap.
+void frame_timing_lap(struct frame_timing *, enum frame_stage stage, long *lap);
+
+/// End a frame. Its stage times are kept if it has been painted, otherwise
+/// they count toward the next frame.
+///
+/// @param log_interval interval between summaries logged, in seconds, 0 for
+///                     none
+void frame_timing_end(struct frame_timing *, long now, unsigned long log_interval);
+
+/// Get the stage with the given name, or NUM_FRAME_STAGES if there is none.
+enum frame_stage frame_stage_from_name(const char *name);
+
+/// Average time spent in `stage` by recent frames, in microseconds.
+long frame_timing_avg(const struct frame_timing *, enum frame_stage stage);
+
+/// Longest time spent in `stage` by recent frames, in microseconds.
+long frame_timing_max(const struct frame_timing *, enum frame_stage stage);
+
+/// Time spent in `stage` by the last painted frame, in microseconds.
+long frame_timing_last(const struct frame_timing *, enum frame_stage stage);
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "utils.h"
+
+#include "trace.h"
+
+/// How often the writer thread empties the ring buffer, in nanoseconds.
+#define TRACE_FLUSH_INTERVAL_NS 50000000L
+
+struct trace_event {
+	const char *name;
+	const char *cat;
+	long ts, dur;
+	uint32_t window;
+	char detail[TRACE_DETAIL_LEN];
+};
+
+struct tracer {
+	FILE *f;
+	pthread_t writer;
+	/// Process ID written with every span.
+	int pid;
+	/// Whether an event has been written, i.e. the next one needs a comma.
+	bool written;
+	atomic_bool quit;
+
+	/// Spans are put in at `head` by the compositor, and taken out at `tail`
+	/// by the writer. Both only ever increase, and wrap around the ring.
+	atomic_uint head, tail;
+	/// Number of spans dropped because the ring was full. Only touched by
+	/// the compositor.
+	unsigned long dropped;
+	struct trace_event events[TRACE_BUFFER_SIZE];
+};
+
+void trace_span(struct tracer *t, const char *name, const char *cat, long start,
+                long end, const char *detail, uint32_t window) {
+	if (!t)
+		return;
+	unsigned head = atomic_load_explicit(&t->head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&t->tail, memory_order_acquire);
+	if (head - tail >= TRACE_BUFFER_SIZE) {
+		t->dropped++;
+		return;
+	}
+
+	struct trace_event *e = &t->events[head % TRACE_BUFFER_SIZE];
+	e->name = name;
+	e->cat = cat;
+	e->ts = start;
+	e->dur = end - start;
+	e->window = window;
+	if (detail) {
+		strncpy(e->detail, detail, TRACE_DETAIL_LEN - 1);
+		e->detail[TRACE_DETAIL_LEN - 1] = '\0';
+	} else {
+		e->detail[0] = '\0';
+	}
+	atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+/// Write a string as a JSON string, without the quotes.
+static void trace_write_escaped(FILE *f, const char *s) {
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", *s);
+		else
+			fputc(*s, f);
+	}
+}
+
+static void trace_write(struct tracer *t, const struct trace_event *e) {
+	fprintf(t->f,
+	        "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%ld,"
+	        "\"dur\":%ld,\"pid\":%d,\"tid\":1,\"args\":{",
+	        t->written ? "," : "", e->name, e->cat, e->ts, e->dur, t->pid);
+	t->written = true;
+
+	bool first = true;
+	if (e->detail[0]) {
+		fputs("\"detail\":\"", t->f);
+		trace_write_escaped(t->f, e->detail);
+		fputc('"', t->f);
+		first = false;
+	}
+	if (e->window)
+		fprintf(t->f, "%s\"window\":\"%#010x\"", first ? "" : ",", e->window);
+	fputs("}}", t->f);
+}
+
+/// Write out all spans in the ring buffer.
+static void trace_drain(struct tracer *t) {
+	unsigned tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+	unsigned head = atomic_load_explicit(&t->head, memory_order_acquire);
+	for (; tail != head; tail++) {
+		trace_write(t, &t->events[tail % TRACE_BUFFER_SIZE]);
+		// Hand the slot back right away, so a long write leaves more room
+		atomic_store_explicit(&t->tail, tail + 1, memory_order_release);
+	}
+	fflush(t->f);
+}
+
+static void *trace_writer(void *arg) {
+	struct tracer *t = arg;
+	const struct timespec interval = {.tv_nsec = TRACE_FLUSH_INTERVAL_NS};
+	while (!atomic_load(&t->quit)) {
+		trace_drain(t);
+		nanosleep(&interval, NULL);
+	}
+	trace_drain(t);
+	return NULL;
+}
+
+struct tracer *trace_start(const char *path) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		log_error("Failed to open trace file %s.", path);
+		return NULL;
+	}
+
+	auto t = ccalloc(1, struct tracer);
+	t->f = f;
+	t->pid = getpid();
+	atomic_init(&t->quit, false);
+	atomic_init(&t->head, 0);
+	atomic_init(&t->tail, 0);
+	fputs("[", f);
+
+	if (pthread_create(&t->writer, NULL, trace_writer, t)) {
+		log_error("Failed to start the trace writer thread.");
+		fclose(f);
+		free(t);
+		return NULL;
+	}
+	log_info("Tracing to %s.", path);
+	return t;
+}
+
+void trace_stop(struct tracer *t) {
+	if (!t)
+		return;
+	atomic_store(&t->quit, true);
+	pthread_join(t->writer, NULL);
+	fputs("\n]\n", t->f);
+	fclose(t->f);
+	if (t->dropped)
+		log_warn("%lu spans were dropped from the trace, the buffer was full.",
+		         t->dropped);
+	log_info("Tracing stopped.");
+	free(t);
+}
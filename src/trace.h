@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdint.h>
+
+#include "pacing.h"
+
+/// Traces of what the compositor does, written as Chrome trace events, which
+/// chrome://tracing and Perfetto can show on a timeline.
+///
+/// Spans are put into a fixed size ring buffer without locking, and written
+/// out by a separate thread, so tracing never waits for the disk. Spans are
+/// dropped when the ring is full.
+
+/// Number of spans the ring buffer holds.
+#define TRACE_BUFFER_SIZE 16384
+
+/// Longest detail kept for a span, longer ones are cut.
+#define TRACE_DETAIL_LEN 32
+
+struct tracer;
+
+/// Start writing spans to the file at `path`. Returns NULL on failure.
+struct tracer *trace_start(const char *path);
+
+/// Write out the remaining spans, and close the file.
+void trace_stop(struct tracer *);
+
+/// Start a span. Returns 0 if tracing is off, then the span is never written.
+static inline long trace_begin(const struct tracer *t) {
+	return t ? pacing_now() : 0;
+}
+
+/// Record a span from `start` to `end`, in microseconds on the pacing_now()
+/// clock.
+///
+/// @param name   name of the span, must be a string literal
+/// @param cat    category of the span, must be a string literal
+/// @param detail what the span is about, copied, can be NULL
+/// @param window window the span is about, or 0
+void trace_span(struct tracer *, const char *name, const char *cat, long start,
+                long end, const char *detail, uint32_t window);
+
+/// End a span started by trace_begin().
+static inline void trace_end(struct tracer *t, long start, const char *name,
+                             const char *cat, const char *detail, uint32_t window) {
+	if (t && start)
+		trace_span(t, name, cat, start, pacing_now(), detail, window);
+}
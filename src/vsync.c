@@ -7,6 +7,10 @@
 #include "log.h"
 
 #ifdef CONFIG_OPENGL
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "backend/gl/glx.h"
 #include "opengl.h"
 #endif
@@ -18,9 +22,15 @@
 #include <drm.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <xf86drm.h>
 #endif
 
 #include "config.h"
+#include "latency.h"
+#include "pacing.h"
+#include "present.h"
+#include "probe.h"
+#include "timing.h"
 #include "vsync.h"
 
 #ifdef CONFIG_VSYNC_DRM
@@ -74,6 +84,334 @@ vsync_drm_init(session_t *ps) {
 #endif
 }
 
+/**
+ * Show the frame waiting for a vblank.
+ *
+ * @param when time of the vblank, 0 if unknown
+ */
+static void
+vsync_show_pending(session_t *ps, long when) {
+  if (!ps->vblank_pending)
+    return;
+
+  if (ps->pacing && when)
+    pacing_vblank(ps->pacing, when);
+  if (!when)
+    when = pacing_now();
+  latency_frame_shown(ps->latency, when);
+  frame_timing_shown(ps->timing, when, ps->refresh_intv);
+
+  // Empty if the frame was dropped
+  if (pixman_region32_not_empty(&ps->vblank_commit_region)) {
+    paint_commit(ps, &ps->vblank_commit_region);
+    XFlush(ps->dpy);
+#ifdef CONFIG_OPENGL
+    if (glx_has_context(ps))
+      glFlush();
+#endif
+  }
+  ps->vblank_pending = false;
+
+  resume_redraw(ps);
+}
+
+#ifdef CONFIG_VSYNC_DRM
+/**
+ * Called by drmHandleEvent() when the queued vblank event comes.
+ */
+static void
+vsync_drm_event_handler(int fd, unsigned int sequence, unsigned int tv_sec,
+    unsigned int tv_usec, void *user_data) {
+  vsync_show_pending(user_data, tv_sec * 1000000L + tv_usec);
+}
+
+static void
+vsync_drm_io_callback(EV_P_ ev_io *w, int revents) {
+  session_t *ps = (session_t *)((char *)w - offsetof(session_t, drm_io));
+  drmEventContext evctx = {
+    .version = 2,
+    .vblank_handler = vsync_drm_event_handler,
+  };
+  if (drmHandleEvent(ps->drm_fd, &evctx))
+    log_error("Failed to read DRM events.");
+}
+#endif
+
+/**
+ * Queue a vblank event, which calls vsync_drm_event_handler().
+ */
+static bool
+vsync_drm_queue_vblank(session_t *ps) {
+#ifdef CONFIG_VSYNC_DRM
+  drmVBlank vbl = {
+    .request = {
+      .type = DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT,
+      .sequence = 1,
+      .signal = (unsigned long)ps,
+    },
+  };
+  return !drmWaitVBlank(ps->drm_fd, &vbl);
+#else
+  return false;
+#endif
+}
+
+/**
+ * Initialize event-driven DRM VSync.
+ *
+ * @return true for success, false otherwise
+ */
+static bool
+vsync_drm_event_init(session_t *ps) {
+#ifdef CONFIG_VSYNC_DRM
+  if (ps->drm_fd < 0 && (ps->drm_fd = open("/dev/dri/card0", O_RDWR)) < 0) {
+    log_error("Failed to open device.");
+    return false;
+  }
+
+  // Find out now if the device can't deliver vblank events, rather than on
+  // every frame. The event of this one is ignored, no frame is pending.
+  if (!vsync_drm_queue_vblank(ps)) {
+    log_error("Failed to queue a vblank event, unsupported by this driver?");
+    return false;
+  }
+
+  ev_io_init(&ps->drm_io, vsync_drm_io_callback, ps->drm_fd, EV_READ);
+  ev_io_start(ps->loop, &ps->drm_io);
+  return true;
+#else
+  log_error("compton is not compiled with DRM VSync support.");
+  return false;
+#endif
+}
+
+#ifdef CONFIG_VSYNC_DRM
+static void
+vsync_drm_event_deinit(session_t *ps) {
+  ev_io_stop(ps->loop, &ps->drm_io);
+}
+#endif
+
+#ifdef CONFIG_OPENGL
+/**
+ * Wait for next VSync with SGI_video_sync, on the current context.
+ */
+static void
+vsync_opengl_wait_sgi(void) {
+  unsigned vblank_count = 0;
+
+  glXGetVideoSyncSGI(&vblank_count);
+  glXWaitVideoSyncSGI(2, (vblank_count + 1) % 2, &vblank_count);
+  // I see some code calling glXSwapIntervalSGI(1) afterwards, is it required?
+}
+
+/**
+ * Wait for next VSync with OML_sync_control.
+ *
+ * https://mail.gnome.org/archives/clutter-list/2012-November/msg00031.html
+ */
+static void
+vsync_opengl_wait_oml(Display *dpy, GLXDrawable d) {
+  int64_t ust = 0, msc = 0, sbc = 0;
+
+  glXGetSyncValuesOML(dpy, d, &ust, &msc, &sbc);
+  glXWaitForMscOML(dpy, d, 0, 2, (msc + 1) % 2,
+      &ust, &msc, &sbc);
+}
+
+/**
+ * Helper thread doing the OpenGL VSync waits.
+ *
+ * The main thread hands it a painted frame and goes back to the event loop,
+ * the thread waits for the vblank and signals an eventfd, and the frame is
+ * committed from the event loop right after the vblank. GLX calls can't
+ * share a connection or a context with the main thread, so the thread has its
+ * own. It is current on the window compton paints to, as the vblank counter
+ * of a window that isn't on screen may not follow any monitor.
+ */
+struct vsync_thread {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  /// Whether a vblank wait has been requested.
+  bool requested;
+  /// Whether the thread should exit.
+  bool quit;
+  /// Whether the thread failed to make its context current.
+  bool failed;
+  /// Written to after each vblank wait.
+  int efd;
+  vsync_t method;
+  Display *dpy;
+  /// The overlay or the root window, not owned by the thread.
+  Window win;
+  GLXContext ctx;
+};
+
+static void *
+vsync_thread_main(void *arg) {
+  struct vsync_thread *t = arg;
+  bool ok = glXMakeCurrent(t->dpy, t->win, t->ctx);
+
+  pthread_mutex_lock(&t->lock);
+  t->failed = !ok;
+  while (true) {
+    while (!t->requested && !t->quit)
+      pthread_cond_wait(&t->cond, &t->lock);
+    if (t->quit)
+      break;
+    t->requested = false;
+    pthread_mutex_unlock(&t->lock);
+
+    if (ok) {
+      if (t->method == VSYNC_OPENGL_OML)
+        vsync_opengl_wait_oml(t->dpy, t->win);
+      else
+        vsync_opengl_wait_sgi();
+    }
+    uint64_t one = 1;
+    if (write(t->efd, &one, sizeof(one)) != sizeof(one))
+      log_error("Failed to signal the end of a vblank wait.");
+
+    pthread_mutex_lock(&t->lock);
+  }
+  pthread_mutex_unlock(&t->lock);
+
+  if (ok)
+    glXMakeCurrent(t->dpy, None, NULL);
+  return NULL;
+}
+
+static void
+vsync_thread_free(struct vsync_thread *t) {
+  if (t->ctx)
+    glXDestroyContext(t->dpy, t->ctx);
+  if (t->dpy)
+    XCloseDisplay(t->dpy);
+  if (t->efd >= 0)
+    close(t->efd);
+  free(t);
+}
+
+static void
+vsync_thread_stop(session_t *ps) {
+  struct vsync_thread *t = ps->vsync_thread;
+  if (!t)
+    return;
+
+  ev_io_stop(ps->loop, &ps->vsync_thread_io);
+  pthread_mutex_lock(&t->lock);
+  t->quit = true;
+  pthread_cond_signal(&t->cond);
+  pthread_mutex_unlock(&t->lock);
+  // Takes at most one vblank
+  pthread_join(t->thread, NULL);
+  pthread_cond_destroy(&t->cond);
+  pthread_mutex_destroy(&t->lock);
+
+  vsync_thread_free(t);
+  ps->vsync_thread = NULL;
+}
+
+static void
+vsync_thread_io_callback(EV_P_ ev_io *w, int revents) {
+  session_t *ps = (session_t *)((char *)w - offsetof(session_t, vsync_thread_io));
+  uint64_t count = 0;
+  if (read(w->fd, &count, sizeof(count)) != sizeof(count))
+    return;
+
+  pthread_mutex_lock(&ps->vsync_thread->lock);
+  bool failed = ps->vsync_thread->failed;
+  pthread_mutex_unlock(&ps->vsync_thread->lock);
+  if (failed) {
+    log_error("Failed to use the OpenGL context of the VSync thread, "
+        "waiting on the main thread from now on.");
+    vsync_thread_stop(ps);
+    vsync_show_pending(ps, 0);
+    return;
+  }
+
+  vsync_show_pending(ps, pacing_now());
+}
+
+/**
+ * Start the helper thread for the current OpenGL VSync method.
+ */
+static bool
+vsync_thread_start(session_t *ps) {
+  auto t = ccalloc(1, struct vsync_thread);
+  t->efd = -1;
+  t->method = ps->o.vsync;
+
+  // Xlib must have been made thread safe before the first connection was
+  // opened, which main() does
+  t->dpy = XOpenDisplay(DisplayString(ps->dpy));
+  if (!t->dpy) {
+    log_error("Failed to open a second connection to the X server.");
+    goto err;
+  }
+
+  // The context needs the visual of the window it is made current on
+  t->win = get_tgt_window(ps);
+  XWindowAttributes wattr;
+  if (!XGetWindowAttributes(t->dpy, t->win, &wattr)) {
+    log_error("Failed to get the attributes of the target window.");
+    goto err;
+  }
+  XVisualInfo vi_tmpl = { .visualid = XVisualIDFromVisual(wattr.visual) };
+  int nvi = 0;
+  XVisualInfo *vi = XGetVisualInfo(t->dpy, VisualIDMask, &vi_tmpl, &nvi);
+  int use_gl = 0;
+  if (!vi || glXGetConfig(t->dpy, vi, GLX_USE_GL, &use_gl) || !use_gl) {
+    log_error("The visual of the target window doesn't support OpenGL.");
+    if (vi)
+      XFree(vi);
+    goto err;
+  }
+  t->ctx = glXCreateContext(t->dpy, vi, NULL, True);
+  XFree(vi);
+  if (!t->ctx) {
+    log_error("Failed to create a GLX context.");
+    goto err;
+  }
+
+  t->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (t->efd < 0) {
+    log_error("Failed to create an eventfd.");
+    goto err;
+  }
+
+  pthread_mutex_init(&t->lock, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  if (pthread_create(&t->thread, NULL, vsync_thread_main, t)) {
+    log_error("Failed to create a thread.");
+    pthread_cond_destroy(&t->cond);
+    pthread_mutex_destroy(&t->lock);
+    goto err;
+  }
+
+  ps->vsync_thread = t;
+  ev_io_init(&ps->vsync_thread_io, vsync_thread_io_callback, t->efd, EV_READ);
+  ev_io_start(ps->loop, &ps->vsync_thread_io);
+  return true;
+
+err:
+  vsync_thread_free(t);
+  return false;
+}
+
+/**
+ * Start the VSync thread, or keep waiting on the main thread if that fails.
+ */
+static bool
+vsync_opengl_start(session_t *ps) {
+  if (!vsync_thread_start(ps))
+    log_warn("Failed to start the VSync thread, compton will block while "
+        "waiting for VBlank.");
+  return true;
+}
+#endif
+
 /**
  * Initialize OpenGL VSync.
  *
@@ -88,7 +426,7 @@ vsync_opengl_init(session_t *ps) {
   if (!ensure_glx_context(ps))
     return false;
 
-  return glxext.has_GLX_SGI_video_sync;
+  return glxext.has_GLX_SGI_video_sync && vsync_opengl_start(ps);
 #else
   log_error("compton is not compiled with OpenGL VSync support.");
   return false;
@@ -101,7 +439,7 @@ vsync_opengl_oml_init(session_t *ps) {
   if (!ensure_glx_context(ps))
     return false;
 
-  return glxext.has_GLX_OML_sync_control;
+  return glxext.has_GLX_OML_sync_control && vsync_opengl_start(ps);
 #else
   log_error("compton is not compiled with OpenGL VSync support.");
   return false;
@@ -154,42 +492,44 @@ vsync_opengl_mswc_init(session_t *ps) {
   return vsync_opengl_swc_init(ps);
 }
 
+/**
+ * Initialize X Present VSync.
+ *
+ * Presentation is paced by Present events, so there is no wait function.
+ */
+static bool
+vsync_present_init(session_t *ps) {
+  return present_init(ps);
+}
+
 bool (*const VSYNC_FUNCS_INIT[NUM_VSYNC])(session_t *ps) = {
   [VSYNC_DRM          ] = vsync_drm_init,
   [VSYNC_OPENGL       ] = vsync_opengl_init,
   [VSYNC_OPENGL_OML   ] = vsync_opengl_oml_init,
   [VSYNC_OPENGL_SWC   ] = vsync_opengl_swc_init,
   [VSYNC_OPENGL_MSWC  ] = vsync_opengl_mswc_init,
+  [VSYNC_PRESENT      ] = vsync_present_init,
+  [VSYNC_DRM_EVENT    ] = vsync_drm_event_init,
 };
 
 #ifdef CONFIG_OPENGL
 /**
  * Wait for next VSync, OpenGL method.
+ *
+ * Only used if the VSync thread couldn't be started.
  */
 static int
 vsync_opengl_wait(session_t *ps) {
-  unsigned vblank_count = 0;
-
-  glXGetVideoSyncSGI(&vblank_count);
-  glXWaitVideoSyncSGI(2, (vblank_count + 1) % 2, &vblank_count);
-  // I see some code calling glXSwapIntervalSGI(1) afterwards, is it required?
-
+  vsync_opengl_wait_sgi();
   return 0;
 }
 
 /**
  * Wait for next VSync, OpenGL OML method.
- *
- * https://mail.gnome.org/archives/clutter-list/2012-November/msg00031.html
  */
 static int
 vsync_opengl_oml_wait(session_t *ps) {
-  int64_t ust = 0, msc = 0, sbc = 0;
-
-  glXGetSyncValuesOML(ps->dpy, ps->reg_win, &ust, &msc, &sbc);
-  glXWaitForMscOML(ps->dpy, ps->reg_win, 0, 2, (msc + 1) % 2,
-      &ust, &msc, &sbc);
-
+  vsync_opengl_wait_oml(ps->dpy, ps->reg_win);
   return 0;
 }
 
@@ -217,8 +557,14 @@ vsync_opengl_swc_deinit(session_t *ps) {
 /// Function pointers to deinitialize VSync.
 void (*const VSYNC_FUNCS_DEINIT[NUM_VSYNC])(session_t *ps) = {
 #ifdef CONFIG_OPENGL
+  [VSYNC_OPENGL       ] = vsync_thread_stop,
+  [VSYNC_OPENGL_OML   ] = vsync_thread_stop,
   [VSYNC_OPENGL_SWC   ] = vsync_opengl_swc_deinit,
   [VSYNC_OPENGL_MSWC  ] = vsync_opengl_swc_deinit,
+#endif
+  [VSYNC_PRESENT      ] = present_deinit,
+#ifdef CONFIG_VSYNC_DRM
+  [VSYNC_DRM_EVENT    ] = vsync_drm_event_deinit,
 #endif
 };
 
@@ -245,11 +591,17 @@ bool vsync_init(session_t *ps) {
  * Wait for next VSync.
  */
 void vsync_wait(session_t *ps) {
-  if (!ps->o.vsync)
+  if (!ps->o.vsync || vsync_is_async(ps))
     return;
 
-  if (VSYNC_FUNCS_WAIT[ps->o.vsync])
+  if (VSYNC_FUNCS_WAIT[ps->o.vsync]) {
+    PROBE(vsync_wait_begin, ps->o.vsync);
     VSYNC_FUNCS_WAIT[ps->o.vsync](ps);
+    PROBE(vsync_wait_end, ps->o.vsync);
+    // We just woke up on a vblank
+    if (ps->pacing)
+      pacing_vblank(ps->pacing, pacing_now());
+  }
 }
 
 /**
@@ -258,4 +610,61 @@ void vsync_wait(session_t *ps) {
 void vsync_deinit(session_t *ps) {
   if (ps->o.vsync && VSYNC_FUNCS_DEINIT[ps->o.vsync])
     VSYNC_FUNCS_DEINIT[ps->o.vsync](ps);
+  // Whatever is still waiting for a vblank will never be shown
+  ps->vblank_pending = false;
+}
+
+/**
+ * Check if the previous frame has been shown.
+ */
+bool vsync_can_paint(session_t *ps) {
+  if (ps->o.vsync == VSYNC_PRESENT)
+    return present_can_paint(ps);
+  return !ps->vblank_pending;
+}
+
+/**
+ * Check if frames are shown from vblank events, instead of after vsync_wait().
+ */
+bool vsync_is_async(session_t *ps) {
+#ifdef CONFIG_OPENGL
+  if (ps->vsync_thread)
+    return true;
+#endif
+  return ps->o.vsync == VSYNC_DRM_EVENT;
+}
+
+/**
+ * Show the painted frame on the next vblank, without waiting for it.
+ */
+void vsync_queue_frame(session_t *ps, const region_t *region) {
+  bool queued = false;
+  if (ps->o.vsync == VSYNC_DRM_EVENT)
+    queued = vsync_drm_queue_vblank(ps);
+#ifdef CONFIG_OPENGL
+  else if (ps->vsync_thread) {
+    struct vsync_thread *t = ps->vsync_thread;
+    pthread_mutex_lock(&t->lock);
+    t->requested = true;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    queued = true;
+  }
+#endif
+
+  if (!queued) {
+    log_error("Failed to wait for vblank, showing the frame right away.");
+    paint_commit(ps, region);
+    return;
+  }
+  pixman_region32_copy(&ps->vblank_commit_region, (region_t *)region);
+  ps->vblank_pending = true;
+}
+
+/**
+ * Forget the frame waiting for a vblank, because the buffer it would be shown
+ * from is going away. New frames are still held back until the vblank.
+ */
+void vsync_drop_frame(session_t *ps) {
+  pixman_region32_clear(&ps->vblank_commit_region);
 }
@@ -2,8 +2,18 @@
 // Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
 #include <stdbool.h>
 
+#include "region.h"
+
 typedef struct session session_t;
 
 bool vsync_init(session_t *ps);
 void vsync_wait(session_t *ps);
 void vsync_deinit(session_t *ps);
+/// Whether the previous frame has been shown, so a new one can be painted.
+bool vsync_can_paint(session_t *ps);
+/// Whether frames are shown from vblank events, instead of after vsync_wait().
+bool vsync_is_async(session_t *ps);
+/// Show the painted frame on the next vblank, without waiting for it.
+void vsync_queue_frame(session_t *ps, const region_t *region);
+/// Forget the frame waiting for a vblank, e.g. when the target buffer is freed.
+void vsync_drop_frame(session_t *ps);
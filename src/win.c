@@ -23,6 +23,9 @@
 #include "utils.h"
 #include "log.h"
 #include "types.h"
+#include "probe.h"
+#include "record.h"
+#include "roundtrip.h"
 #include "region.h"
 #include "render.h"
 
@@ -246,8 +249,9 @@ static inline bool win_bounding_shaped(const session_t *ps, xcb_window_t wid) {
     xcb_shape_query_extents_reply_t *reply;
     Bool bounding_shaped;
 
-    reply = xcb_shape_query_extents_reply(ps->c,
-        xcb_shape_query_extents(ps->c, wid), NULL);
+    reply = record_reply(RECORD_TAG_SHAPE_QUERY_EXTENTS,
+        X_ROUND_TRIP("shape_query_extents", xcb_shape_query_extents_reply(ps->c,
+          xcb_shape_query_extents(ps->c, wid), NULL)));
     bounding_shaped = reply && reply->bounding_shaped;
     free(reply);
 
@@ -380,6 +384,7 @@ void win_calc_dim(session_t *ps, win *w) {
  * Determine if a window should fade on opacity change.
  */
 void win_determine_fade(session_t *ps, win *w) {
+  const bool fade_old = w->fade;
   // To prevent it from being overwritten by last-paint value if the window is
   // unmapped on next frame, write w->fade_last as well
   if (UNSET != w->fade_force)
@@ -397,6 +402,10 @@ void win_determine_fade(session_t *ps, win *w) {
     w->fade = false;
   else
     w->fade = ps->o.wintype_option[w->window_type].fade;
+
+  // The fade state is saved when the window is painted
+  if (w->fade != fade_old)
+    win_mark_changed(ps, w);
 }
 
 /**
@@ -439,6 +448,7 @@ void win_set_shadow(session_t *ps, win *w, bool shadow_new) {
   win_extents(w, &extents);
 
   w->shadow = shadow_new;
+  win_mark_changed(ps, w);
 
   // Window extents need update on shadow state change
   // Shadow geometry currently doesn't change on shadow state change
@@ -480,6 +490,7 @@ void win_set_invert_color(session_t *ps, win *w, bool invert_color_new) {
     return;
 
   w->invert_color = invert_color_new;
+  win_mark_changed(ps, w);
 
   add_damage_from_win(ps, w);
 }
@@ -504,6 +515,7 @@ void win_set_blur_background(session_t *ps, win *w, bool blur_background_new) {
     return;
 
   w->blur_background = blur_background_new;
+  win_mark_changed(ps, w);
 
   // Only consider window damaged if it's previously painted with background
   // blurred
@@ -551,6 +563,18 @@ void win_update_opacity_rule(session_t *ps, win *w) {
     wid_set_opacity_prop(ps, w->id, opacity);
 }
 
+/**
+ * Determine the damage rate limit of a window from the damage rate rules.
+ */
+void win_determine_damage_rate(session_t *ps, win *w) {
+  void *val = NULL;
+  if (w->a.map_state == XCB_MAP_STATE_VIEWABLE &&
+      c2_match(ps, w, ps->o.damage_rate_rules, &w->cache_drrule, &val))
+    w->damage_rate_limit = (int)(long)val;
+  else
+    w->damage_rate_limit = 0;
+}
+
 /**
  * Function to be called on window type changes.
  */
@@ -562,6 +586,8 @@ void win_on_wtype_change(session_t *ps, win *w) {
     win_determine_invert_color(ps, w);
   if (ps->o.opacity_rules)
     win_update_opacity_rule(ps, w);
+  if (ps->o.damage_rate_rules)
+    win_determine_damage_rate(ps, w);
 }
 
 /**
@@ -580,6 +606,8 @@ void win_on_factor_change(session_t *ps, win *w) {
     win_determine_blur_background(ps, w);
   if (ps->o.opacity_rules)
     win_update_opacity_rule(ps, w);
+  if (ps->o.damage_rate_rules)
+    win_determine_damage_rate(ps, w);
   if (w->a.map_state == XCB_MAP_STATE_VIEWABLE && ps->o.paint_blacklist)
     w->paint_excluded =
         c2_match(ps, w, ps->o.paint_blacklist, &w->cache_pblst, NULL);
@@ -587,6 +615,7 @@ void win_on_factor_change(session_t *ps, win *w) {
     w->unredir_if_possible_excluded = c2_match(
         ps, w, ps->o.unredir_if_possible_blacklist, &w->cache_uipblst, NULL);
   w->reg_ignore_valid = false;
+  win_mark_changed(ps, w);
 }
 
 /**
@@ -597,6 +626,7 @@ void calc_win_size(session_t *ps, win *w) {
   w->heightb = w->g.height + w->g.border_width * 2;
   calc_shadow_geometry(ps, w);
   w->flags |= WFLAG_SIZE_CHANGE;
+  win_mark_changed(ps, w);
   // Invalidate the shadow we built
   free_paint(ps, &w->shadow_paint);
 }
@@ -650,10 +680,10 @@ void win_mark_client(session_t *ps, win *w, xcb_window_t client) {
   if (w->a.map_state != XCB_MAP_STATE_VIEWABLE)
     return;
 
-  auto e = xcb_request_check(
+  auto e = X_ROUND_TRIP("change_window_attributes", xcb_request_check(
       ps->c, xcb_change_window_attributes(
            ps->c, client, XCB_CW_EVENT_MASK,
-           (const uint32_t[]){determine_evmask(ps, client, WIN_EVMODE_CLIENT)}));
+           (const uint32_t[]){determine_evmask(ps, client, WIN_EVMODE_CLIENT)})));
   if (e) {
 	  log_error("Failed to change event mask of window %#010x", client);
 	  free(e);
@@ -735,6 +765,8 @@ void win_recheck_client(session_t *ps, win *w) {
 
 // TODO: probably split into win_new (in win.c) and add_win (in compton.c)
 bool add_win(session_t *ps, xcb_window_t id, xcb_window_t prev) {
+  PROBE(add_win, id, prev);
+
   static const win win_def = {
       .win_data = NULL,
       .next = NULL,
@@ -784,6 +816,7 @@ bool add_win(session_t *ps, xcb_window_t id, xcb_window_t prev) {
       .cache_ivclst = NULL,
       .cache_bbblst = NULL,
       .cache_oparule = NULL,
+      .cache_drrule = NULL,
 
       .opacity = 0,
       .opacity_tgt = 0,
@@ -846,8 +879,12 @@ bool add_win(session_t *ps, xcb_window_t id, xcb_window_t prev) {
 
   xcb_get_window_attributes_cookie_t acookie = xcb_get_window_attributes(ps->c, id);
   xcb_get_geometry_cookie_t gcookie = xcb_get_geometry(ps->c, id);
-  xcb_get_window_attributes_reply_t *a = xcb_get_window_attributes_reply(ps->c, acookie, NULL);
-  xcb_get_geometry_reply_t *g = xcb_get_geometry_reply(ps->c, gcookie, NULL);
+  xcb_get_window_attributes_reply_t *a = record_reply(
+      RECORD_TAG_GET_WINDOW_ATTRIBUTES,
+      X_ROUND_TRIP("get_window_attributes",
+        xcb_get_window_attributes_reply(ps->c, acookie, NULL)));
+  xcb_get_geometry_reply_t *g = record_reply(RECORD_TAG_GET_GEOMETRY,
+      X_ROUND_TRIP("get_geometry", xcb_get_geometry_reply(ps->c, gcookie, NULL)));
   if (!a || a->map_state == XCB_MAP_STATE_UNVIEWABLE) {
     // Failed to get window attributes probably means the window is gone
     // already. Unviewable means the window is already reparented
@@ -877,8 +914,10 @@ bool add_win(session_t *ps, xcb_window_t id, xcb_window_t prev) {
   if (InputOutput == new->a._class) {
     // Create Damage for window
     new->damage = xcb_generate_id(ps->c);
-    xcb_generic_error_t *e = xcb_request_check(ps->c,
-      xcb_damage_create_checked(ps->c, new->damage, id, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY));
+    xcb_generic_error_t *e = record_reply(RECORD_TAG_DAMAGE_CREATE,
+      X_ROUND_TRIP("damage_create",
+        xcb_request_check(ps->c, xcb_damage_create_checked(ps->c, new->damage,
+          id, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY))));
     if (e) {
       free(e);
       free(new);
@@ -939,6 +978,7 @@ void win_update_focused(session_t *ps, win *w) {
   // options depend on the output value of win_is_focused_real() instead of
   // w->focused
   w->flags |= WFLAG_OPCT_CHANGE;
+  win_mark_changed(ps, w);
 }
 
 /**
@@ -1129,6 +1169,29 @@ win_set_focused(session_t *ps, win *w, bool focused) {
   win_on_focus_change(ps, w);
 }
 
+void win_count_damage(session_t *ps, win *w, long now) {
+  w->damage_events++;
+  if (now - w->damage_period_start < US_PER_SEC)
+    return;
+
+  // A period longer than a second means the window was quiet for a while,
+  // which is part of its rate too
+  if (w->damage_period_start)
+    w->damage_rate = w->damage_events * (double)US_PER_SEC /
+      (now - w->damage_period_start);
+  log_trace("Window %#010x (%s): %.1f damage events per second", w->id,
+      w->name, w->damage_rate);
+  w->damage_period_start = now;
+  w->damage_events = 0;
+}
+
+double win_damage_rate(const win *w, long now) {
+  // The last measurement is too old if the window has been quiet since
+  if (now - w->damage_period_start >= 2 * US_PER_SEC)
+    return 0;
+  return w->damage_rate;
+}
+
 /**
  * Get a rectangular region a window (and possibly its shadow) occupies.
  *
@@ -1167,8 +1230,10 @@ void win_update_bounding_shape(session_t *ps, win *w) {
      * as well as not generate a region.
      */
 
-    xcb_shape_get_rectangles_reply_t *r = xcb_shape_get_rectangles_reply(ps->c,
-        xcb_shape_get_rectangles(ps->c, w->id, XCB_SHAPE_SK_BOUNDING), NULL);
+    xcb_shape_get_rectangles_reply_t *r = record_reply(
+        RECORD_TAG_SHAPE_GET_RECTANGLES,
+        X_ROUND_TRIP("shape_get_rectangles", xcb_shape_get_rectangles_reply(ps->c,
+          xcb_shape_get_rectangles(ps->c, w->id, XCB_SHAPE_SK_BOUNDING), NULL)));
 
     if (!r)
       break;
@@ -1250,6 +1315,8 @@ win_update_frame_extents(session_t *ps, win *w, xcb_window_t client) {
     // is not included in reg_ignore of underneath windows
     if (ps->o.frame_opacity == 1 && changed)
       w->reg_ignore_valid = false;
+    if (changed)
+      win_mark_changed(ps, w);
   }
 
   log_trace("(%#010x): %d, %d, %d, %d", w->id,
@@ -1303,6 +1370,8 @@ void win_set_fade_callback(session_t *ps, win **_w,
   void (*old_callback) (session_t *ps, win **w) = w->fade_callback;
 
   w->fade_callback = callback;
+  if (callback)
+    win_mark_changed(ps, w);
   // Must be the last line as the callback could destroy w!
   if (exec_callback && old_callback)
     old_callback(ps, _w);
@@ -1319,3 +1388,24 @@ win_check_fade_finished(session_t *ps, win **_w) {
     win_set_fade_callback(ps, _w, NULL, true);
   }
 }
+
+void win_mark_changed(session_t *ps, win *w) {
+  if (w->changed)
+    return;
+  w->changed = true;
+  w->next_changed = ps->changed_list;
+  ps->changed_list = w;
+}
+
+void win_unmark_changed(session_t *ps, win *w) {
+  if (!w->changed)
+    return;
+  for (win **p = &ps->changed_list; *p; p = &(*p)->next_changed) {
+    if (*p == w) {
+      *p = w->next_changed;
+      break;
+    }
+  }
+  w->changed = false;
+  w->next_changed = NULL;
+}
@@ -84,6 +84,8 @@ struct win {
   win *next;
   /// Pointer to the next higher window to paint.
   win *prev_trans;
+  /// Pointer to the next window in the set of changed windows.
+  win *next_changed;
 
   // Core members
   /// ID of the top-level frame window.
@@ -113,6 +115,9 @@ struct win {
   region_t bounding_shape;
   /// Window flags. Definitions above.
   int_fast16_t flags;
+  /// Whether the window is in the set of changed windows, which the next
+  /// paint_preprocess() looks at.
+  bool changed;
   /// Whether there's a pending <code>ConfigureNotify</code> happening
   /// when the window is unmapped.
   bool need_configure;
@@ -183,6 +188,7 @@ struct win {
   const c2_lptr_t *cache_oparule;
   const c2_lptr_t *cache_pblst;
   const c2_lptr_t *cache_uipblst;
+  const c2_lptr_t *cache_drrule;
 
   // Opacity-related members
   /// Current window opacity.
@@ -209,6 +215,31 @@ struct win {
   switch_t fade_force;
   /// Callback to be called after fading completed.
   void (*fade_callback) (session_t *ps, win **w);
+  // Damage-rate-related members
+  /// Maximum rate the damage of this window is repaired at, in Hz. 0 if
+  /// unlimited. Set by damage rate rules.
+  int damage_rate_limit;
+  /// Whether a DamageNotify waits for the next allowed repair.
+  bool damage_held;
+  /// When the oldest DamageNotify not repaired yet came in, 0 if none.
+  long damage_time;
+  /// Earliest time of the next repair, in microseconds.
+  long damage_next;
+  /// Start of the current damage rate measurement period, in microseconds.
+  long damage_period_start;
+  /// Number of DamageNotify in the current measurement period.
+  unsigned damage_events;
+  /// DamageNotify rate measured in the last period, in Hz.
+  double damage_rate;
+
+  /// Opacity at the start of the running fade.
+  opacity_t fade_from;
+  /// Opacity the running fade ends at.
+  opacity_t fade_to;
+  /// Start time of the running fade, in microseconds.
+  long fade_start;
+  /// Duration of the running fade, in microseconds. 0 if not fading.
+  long fade_duration;
 
   // Frame-opacity-related members
   /// Current window frame opacity. Affected by window opacity.
@@ -355,9 +386,37 @@ void win_set_fade_callback(session_t *ps, win **_w,
 void
 win_check_fade_finished(session_t *ps, win **_w);
 
+/**
+ * Determine the damage rate limit of a window from the damage rate rules.
+ */
+void win_determine_damage_rate(session_t *ps, win *w);
+
+/**
+ * Count a DamageNotify of a window, for its damage rate.
+ *
+ * @param now current time, in microseconds
+ */
+void win_count_damage(session_t *ps, win *w, long now);
+
+/**
+ * Get the rate of DamageNotify of a window, in Hz.
+ */
+double win_damage_rate(const win *w, long now);
+
 // Stop receiving events (except ConfigureNotify, XXX why?) from a window
 void win_ev_stop(session_t *ps, win *w);
 
+/**
+ * Add a window to the set of changed windows, so the next paint_preprocess()
+ * updates its fading, opacity and painting state.
+ */
+void win_mark_changed(session_t *ps, win *w);
+
+/**
+ * Remove a window from the set of changed windows, before it is freed.
+ */
+void win_unmark_changed(session_t *ps, win *w);
+
 /**
  * Get the leader of a window.
  *
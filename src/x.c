@@ -19,6 +19,8 @@
 #include "common.h"
 #include "x.h"
 #include "log.h"
+#include "record.h"
+#include "roundtrip.h"
 #include "backend/gl/glx.h"
 
 /**
@@ -39,8 +41,9 @@
 winprop_t
 wid_get_prop_adv(const session_t *ps, xcb_window_t w, xcb_atom_t atom, long offset,
     long length, xcb_atom_t rtype, int rformat) {
-  xcb_get_property_reply_t *r = xcb_get_property_reply(ps->c,
-    xcb_get_property(ps->c, 0, w, atom, rtype, offset, length), NULL);
+  xcb_get_property_reply_t *r = record_reply(RECORD_TAG_GET_PROPERTY,
+    X_ROUND_TRIP("get_property", xcb_get_property_reply(ps->c,
+      xcb_get_property(ps->c, 0, w, atom, rtype, offset, length), NULL)));
 
   if (r && xcb_get_property_value_length(r) &&
       (rtype == XCB_GET_PROPERTY_TYPE_ANY || r->type == rtype) &&
@@ -120,9 +123,9 @@ static inline void x_get_server_pictfmts(xcb_connection_t *c) {
     return;
   xcb_generic_error_t *e = NULL;
   // Get window picture format
-  g_pictfmts =
+  g_pictfmts = X_ROUND_TRIP("render_query_pict_formats",
     xcb_render_query_pict_formats_reply(c,
-        xcb_render_query_pict_formats(c), &e);
+        xcb_render_query_pict_formats(c), &e));
   if (e || !g_pictfmts) {
     log_fatal("failed to get pict formats\n");
     abort();
@@ -176,9 +179,9 @@ x_create_picture_with_pictfmt_and_pixmap(
   }
 
   xcb_render_picture_t tmp_picture = xcb_generate_id(c);
-  xcb_generic_error_t *e =
+  xcb_generic_error_t *e = X_ROUND_TRIP("render_create_picture",
     xcb_request_check(c, xcb_render_create_picture_checked(c, tmp_picture,
-      pixmap, pictfmt->id, valuemask, buf));
+      pixmap, pictfmt->id, valuemask, buf)));
   free(buf);
   if (e) {
     log_error("failed to create picture");
@@ -252,8 +255,9 @@ x_create_picture_with_visual(session_t *ps, int w, int h,
 
 bool x_fetch_region(xcb_connection_t *c, xcb_xfixes_region_t r, pixman_region32_t *res) {
   xcb_generic_error_t *e = NULL;
-  xcb_xfixes_fetch_region_reply_t *xr = xcb_xfixes_fetch_region_reply(c,
-    xcb_xfixes_fetch_region(c, r), &e);
+  xcb_xfixes_fetch_region_reply_t *xr = record_reply(RECORD_TAG_FETCH_REGION,
+    X_ROUND_TRIP("xfixes_fetch_region",
+      xcb_xfixes_fetch_region_reply(c, xcb_xfixes_fetch_region(c, r), &e)));
   if (!xr) {
     log_error("Failed to fetch rectangles");
     return false;
@@ -289,9 +293,9 @@ void x_set_picture_clip_region(xcb_connection_t *c, xcb_render_picture_t pict,
       .height = rects[i].y2 - rects[i].y1,
     };
 
-  xcb_generic_error_t *e =
+  xcb_generic_error_t *e = X_ROUND_TRIP("render_set_picture_clip_rectangles",
     xcb_request_check(c, xcb_render_set_picture_clip_rectangles_checked(c, pict,
-      clip_x_origin, clip_y_origin, nrects, xrects));
+      clip_x_origin, clip_y_origin, nrects, xrects)));
   if (e)
     log_error("Failed to set clip region");
   free(e);
@@ -303,9 +307,9 @@ void x_clear_picture_clip_region(xcb_connection_t *c, xcb_render_picture_t pict)
   xcb_render_change_picture_value_list_t v = {
     .clipmask = XCB_NONE
   };
-  xcb_generic_error_t *e =
+  xcb_generic_error_t *e = X_ROUND_TRIP("render_change_picture",
     xcb_request_check(c, xcb_render_change_picture(c, pict,
-      XCB_RENDER_CP_CLIP_MASK, &v));
+      XCB_RENDER_CP_CLIP_MASK, &v)));
   if (e)
     log_error("failed to clear clip region");
   free(e);
@@ -415,7 +419,8 @@ xcb_pixmap_t
 x_create_pixmap(xcb_connection_t *c, uint8_t depth, xcb_drawable_t drawable, uint16_t width, uint16_t height) {
   xcb_pixmap_t pix = xcb_generate_id(c);
   xcb_void_cookie_t cookie = xcb_create_pixmap_checked(c, depth, pix, drawable, width, height);
-  xcb_generic_error_t *err = xcb_request_check(c, cookie);
+  xcb_generic_error_t *err =
+    X_ROUND_TRIP("create_pixmap", xcb_request_check(c, cookie));
   if (err == NULL)
     return pix;
 
@@ -437,7 +442,8 @@ x_validate_pixmap(xcb_connection_t *c, xcb_pixmap_t pixmap) {
     return false;
   }
 
-  auto r = xcb_get_geometry_reply(c, xcb_get_geometry(c, pixmap), NULL);
+  auto r = X_ROUND_TRIP("get_geometry",
+    xcb_get_geometry_reply(c, xcb_get_geometry(c, pixmap), NULL));
   if (!r) {
     return false;
   }
@@ -491,21 +497,24 @@ bool x_fence_sync(xcb_connection_t *c, xcb_sync_fence_t f) {
   // prototype, we need only one fence per screen, but let's stay a bit
   // cautious right now
 
-  auto e = xcb_request_check(c, xcb_sync_trigger_fence_checked(c, f));
+  auto e = X_ROUND_TRIP("sync_trigger_fence",
+    xcb_request_check(c, xcb_sync_trigger_fence_checked(c, f)));
   if (e) {
     log_error("Failed to trigger the fence.");
     free(e);
     return false;
   }
 
-  e = xcb_request_check(c, xcb_sync_await_fence_checked(c, 1, &f));
+  e = X_ROUND_TRIP("sync_await_fence",
+    xcb_request_check(c, xcb_sync_await_fence_checked(c, 1, &f)));
   if (e) {
     log_error("Failed to await on a fence.");
     free(e);
     return false;
   }
 
-  e = xcb_request_check(c, xcb_sync_reset_fence_checked(c, f));
+  e = X_ROUND_TRIP("sync_reset_fence",
+    xcb_request_check(c, xcb_sync_reset_fence_checked(c, f)));
   if (e) {
     log_error("Failed to reset the fence.");
     free(e);
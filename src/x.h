@@ -12,6 +12,7 @@
 
 #include "compiler.h"
 #include "region.h"
+#include "roundtrip.h"
 
 typedef struct session session_t;
 
@@ -32,11 +33,11 @@ typedef struct winprop {
 } winprop_t;
 
 #define XCB_SYNCED_VOID(func, c, ...)                                                    \
-	xcb_request_check(c, func##_checked(c, __VA_ARGS__));
+	X_ROUND_TRIP(#func, xcb_request_check(c, func##_checked(c, __VA_ARGS__)));
 #define XCB_SYNCED(func, c, ...)                                                                 \
 	({                                                                                       \
 		xcb_generic_error_t *e = NULL;                                                   \
-		__auto_type r = func##_reply(c, func(c, __VA_ARGS__), &e);                       \
+		__auto_type r = X_ROUND_TRIP(#func, func##_reply(c, func(c, __VA_ARGS__), &e));  \
 		if (e) {                                                                         \
 			x_print_error(e->sequence, e->major_code, e->minor_code, e->error_code); \
 			free(e);                                                                 \
@@ -49,11 +50,11 @@ typedef struct winprop {
  * requests are processed, and their replies received
  *
  * xcb_get_input_focus is used here because it is the same request used by
- * libX11
+ * libX11. The wait is accounted to the calling function.
  */
-static inline void x_sync(xcb_connection_t *c) {
-	free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
-}
+#define x_sync(c)                                                                        \
+	X_ROUND_TRIP_VOID("sync",                                                        \
+	                  free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL)))
 
 /**
  * Get a specific attribute of a window.
@@ -0,0 +1,416 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# vim:fileencoding=utf-8
+
+"""Headless benchmark harness for compton.
+
+Every scenario runs in a fresh Xvfb, so no GPU or running session is needed,
+and compton talks to a private D-Bus daemon. The scenario decides compton's
+configuration and the windows the workload client creates and damages; the
+harness measures frames per second, CPU time of compton and of the X server,
+compton's memory, and whatever statistics compton reports over D-Bus, then
+writes everything as JSON.
+
+A scenario is a JSON file like:
+
+    {
+        "name": "scroll",
+        "duration": 10,
+        "workload": {"windows": 20, "opacity": 0.9, "pattern": "scroll"},
+        "compton": {"backend": "xrender", "shadow": true}
+    }
+
+"workload" takes the long options of workload.c without the dashes, and
+"compton" is written out as compton's configuration file. An optional
+"screen", like "3840x2160", sets the size of the Xvfb screen, 1920x1080 by
+default. OpenGL scenarios render with Mesa's software rasterizer in Xvfb,
+llvmpipe on most systems.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, '..', '..'))
+
+DBUS_INTERFACE = 'com.github.chjj.compton'
+DBUS_OBJECT = '/com/github/chjj/compton'
+
+# Counters read from compton's stats_get before and after the measurement,
+# the difference is reported
+STATS_COUNTERS = ['events_handled', 'events_deferred', 'events_coalesced',
+                  'event_budget_overruns', 'releases', 'round_trips',
+                  'round_trip_us', 'round_trips_frames', 'evictions',
+                  'vblank_missed_frames', 'vblanks_missed']
+# Values read from stats_get at the end of the measurement
+STATS_GAUGES = ['latency_p50_us', 'latency_p95_us', 'latency_p99_us',
+                'event_backlog_max', 'resource_kib', 'round_trips_max_frame'] + [
+                    'resource_{}_kib'.format(k) for k in [
+                        'pixmap', 'glx_pixmap', 'shadow', 'blur', 'root',
+                        'target']]
+FRAME_STAGES = ['events', 'preprocess', 'region', 'root', 'shadow', 'blur',
+                'composite', 'vsync', 'present', 'xsync']
+
+CLK_TCK = os.sysconf('SC_CLK_TCK')
+
+
+class BenchError(Exception):
+    '''An error that stops a scenario from being measured.'''
+    pass
+
+
+def cpu_seconds(pid):
+    """CPU time used by a process so far, in seconds."""
+    with open('/proc/{}/stat'.format(pid)) as f:
+        # The command name can have spaces, skip past it
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / CLK_TCK
+
+
+def memory_kib(pid):
+    """Current and peak resident memory of a process, in KiB."""
+    rss = hwm = None
+    with open('/proc/{}/status'.format(pid)) as f:
+        for line in f:
+            if line.startswith('VmRSS:'):
+                rss = int(line.split()[1])
+            elif line.startswith('VmHWM:'):
+                hwm = int(line.split()[1])
+    return rss, hwm
+
+
+def libconfig_value(value):
+    """Format a JSON value as a libconfig value."""
+    if isinstance(value, bool):
+        return 'true' if value else 'false'
+    if isinstance(value, (int, float)):
+        return repr(value)
+    if isinstance(value, str):
+        return json.dumps(value)
+    if isinstance(value, list):
+        return '[ ' + ', '.join(libconfig_value(v) for v in value) + ' ]'
+    if isinstance(value, dict):
+        return '{ ' + ' '.join('{} = {};'.format(k, libconfig_value(v))
+                               for k, v in value.items()) + ' }'
+    raise BenchError('cannot write {!r} to the configuration'.format(value))
+
+
+def find_compton():
+    for path in [os.path.join(ROOT, 'build', 'src', 'compton'),
+                 shutil.which('compton')]:
+        if path and os.access(path, os.X_OK):
+            return path
+    raise BenchError('compton not found, build it or use --compton')
+
+
+def build_workload(tmpdir):
+    """Build workload.c, for when no --workload is given."""
+    try:
+        flags = subprocess.check_output(
+            ['pkg-config', '--cflags', '--libs', 'xcb', 'xcb-shape'],
+            universal_newlines=True).split()
+        out = os.path.join(tmpdir, 'workload')
+        subprocess.check_call([os.environ.get('CC', 'cc'), '-std=c11',
+                               '-D_GNU_SOURCE', '-O2',
+                               os.path.join(HERE, 'workload.c'),
+                               '-o', out] + flags)
+    except (OSError, subprocess.CalledProcessError) as e:
+        raise BenchError('cannot build the workload client: {}'.format(e))
+    return out
+
+
+class Session:
+    '''Xvfb, a D-Bus daemon and compton, running for one scenario.'''
+
+    def __init__(self, args, scenario, tmpdir):
+        self.args = args
+        self.scenario = scenario
+        self.screen = args.screen or scenario.get('screen', '1920x1080')
+        self.tmpdir = tmpdir
+        self.procs = []
+        self.env = dict(os.environ)
+
+    def spawn(self, cmd, **kwargs):
+        p = subprocess.Popen(cmd, env=self.env, **kwargs)
+        self.procs.append(p)
+        return p
+
+    def start_xvfb(self):
+        rfd, wfd = os.pipe()
+        self.xvfb = self.spawn(
+            ['Xvfb', '-displayfd', str(wfd), '-nolisten', 'tcp', '-noreset',
+             '-screen', '0', self.screen + 'x24',
+             '+extension', 'COMPOSITE', '+extension', 'RANDR',
+             '+extension', 'GLX'],
+            pass_fds=[wfd], stderr=subprocess.DEVNULL)
+        os.close(wfd)
+        with os.fdopen(rfd) as f:
+            display = f.readline().strip()
+        if not display:
+            raise BenchError('Xvfb failed to start')
+        self.env['DISPLAY'] = ':' + display
+
+    def start_dbus(self):
+        self.dbus = self.spawn(['dbus-daemon', '--session', '--nofork',
+                                '--print-address=1'],
+                               stdout=subprocess.PIPE, universal_newlines=True)
+        address = self.dbus.stdout.readline().strip()
+        if not address:
+            raise BenchError('dbus-daemon failed to start')
+        self.env['DBUS_SESSION_BUS_ADDRESS'] = address
+        self.service = DBUS_INTERFACE + '.' + ''.join(
+            c if c.isalnum() else '_' for c in self.env['DISPLAY'])
+
+    def call_text(self, method, *args):
+        """Call a method of compton, and return its reply as printed by
+        dbus-send, or None if it failed."""
+        cmd = ['dbus-send', '--print-reply=literal', '--dest=' + self.service,
+               DBUS_OBJECT, DBUS_INTERFACE + '.' + method] + list(args)
+        r = subprocess.run(cmd, env=self.env, stdout=subprocess.PIPE,
+                           stderr=subprocess.DEVNULL, universal_newlines=True)
+        if r.returncode != 0:
+            return None
+        return r.stdout
+
+    def call(self, method, *args):
+        """Call a method of compton, and return its reply, or None if it
+        failed."""
+        out = self.call_text(method, *args)
+        if not out or not out.split():
+            return None
+        value = out.split()[-1]
+        try:
+            return int(value)
+        except ValueError:
+            return value
+
+    def start_compton(self):
+        config = os.path.join(self.tmpdir, 'compton.conf')
+        with open(config, 'w') as f:
+            for k, v in self.scenario.get('compton', {}).items():
+                f.write('{} = {};\n'.format(k, libconfig_value(v)))
+        self.log = os.path.join(self.tmpdir, 'compton.log')
+        self.compton = self.spawn([self.args.compton, '--config', config,
+                                   '--dbus', '--log-file', self.log])
+        deadline = time.monotonic() + 10
+        while self.call('timing_get', 'string:frames') is None:
+            if self.compton.poll() is not None:
+                raise BenchError('compton exited with {}'.format(
+                    self.compton.returncode))
+            if time.monotonic() > deadline:
+                raise BenchError('compton did not come up on D-Bus')
+            time.sleep(0.1)
+
+    def start_workload(self):
+        cmd = [self.args.workload]
+        for k, v in self.scenario.get('workload', {}).items():
+            if v is True:
+                cmd.append('--' + k)
+            elif v is not False:
+                cmd += ['--' + k, str(v)]
+        self.workload = self.spawn(cmd, stdout=subprocess.PIPE,
+                                   universal_newlines=True)
+        if self.workload.stdout.readline().strip() != 'ready':
+            raise BenchError('the workload client failed to start')
+
+    def snapshot(self):
+        snap = {
+            'time': time.monotonic(),
+            'frames': self.call('timing_get', 'string:frames'),
+            'compton_cpu': cpu_seconds(self.compton.pid),
+            'xserver_cpu': cpu_seconds(self.xvfb.pid),
+        }
+        for key in STATS_COUNTERS:
+            snap[key] = self.call('stats_get', 'string:' + key)
+        snap['round_trips'] = self.round_trips()
+        snap['histograms'] = self.histograms()
+        return snap
+
+    def histograms(self):
+        """Get compton's frame histograms, as a dict of the bucket counts of
+        each, and the bucket bounds under 'bounds'."""
+        report = {}
+        for line in (self.call_text('histogram_get') or '').splitlines():
+            fields = line.strip().split('\t')
+            if fields[0] == 'bounds':
+                report['bounds'] = [int(f) for f in fields[1:]]
+            elif len(fields) > 3 and fields[0] in ('interval', 'render'):
+                report[fields[0]] = [int(f) for f in fields[3:]]
+        return report
+
+    def round_trips(self):
+        """Get compton's round trip report, as a dict of the count and
+        microseconds waited for each total, event type and call site."""
+        report = {}
+        for line in (self.call_text('round_trips_get') or '').splitlines():
+            fields = line.strip().split('\t')
+            if len(fields) >= 3:
+                report[fields[0]] = (int(fields[1]), int(fields[2]))
+        return report
+
+    def measure(self, duration):
+        time.sleep(self.args.warmup)
+        before = self.snapshot()
+        rss_peak = 0
+        end = before['time'] + duration
+        while time.monotonic() < end:
+            if self.compton.poll() is not None:
+                raise BenchError('compton exited with {}'.format(
+                    self.compton.returncode))
+            rss_peak = max(rss_peak, memory_kib(self.compton.pid)[0] or 0)
+            time.sleep(min(0.5, max(end - time.monotonic(), 0)))
+        after = self.snapshot()
+        rss, hwm = memory_kib(self.compton.pid)
+
+        elapsed = after['time'] - before['time']
+        frames = None
+        if after['frames'] is not None and before['frames'] is not None:
+            frames = after['frames'] - before['frames']
+        result = {
+            'duration_s': round(elapsed, 3),
+            'frames': frames,
+            'fps': round(frames / elapsed, 2) if frames is not None else None,
+            'compton_cpu_s': round(after['compton_cpu'] -
+                                   before['compton_cpu'], 3),
+            'xserver_cpu_s': round(after['xserver_cpu'] -
+                                   before['xserver_cpu'], 3),
+            'rss_kib': rss,
+            'rss_peak_kib': max(rss_peak, rss or 0),
+            'rss_high_water_kib': hwm,
+            'stats': {},
+            'stage_avg_us': {},
+        }
+        # Statistics compton doesn't know about are left null
+        for key in STATS_COUNTERS:
+            if isinstance(after[key], int) and isinstance(before[key], int):
+                # Counters are 32 bit, and can wrap around
+                result['stats'][key] = (after[key] - before[key]) % 2**32
+            else:
+                result['stats'][key] = None
+        # Round trips made during the measurement, by event type and call
+        # site, most time spent first
+        result['round_trips'] = {'events': {}, 'sites': {}}
+        diff = []
+        for key, (count, us) in after['round_trips'].items():
+            b = before['round_trips'].get(key, (0, 0))
+            if count > b[0]:
+                diff.append((us - b[1], count - b[0], key))
+        for us, count, key in sorted(diff, reverse=True):
+            kind, _, name = key.partition(':')
+            if kind in ('event', 'site'):
+                result['round_trips'][kind + 's'][name] = {
+                    'count': count, 'us': us}
+        # Frames in each histogram bucket during the measurement, the last
+        # bucket has no upper bound
+        result['histograms'] = {'bounds_us': after['histograms'].get('bounds')}
+        for name in ('interval', 'render'):
+            a = after['histograms'].get(name)
+            b = before['histograms'].get(name, [0] * len(a or []))
+            result['histograms'][name] = [
+                x - y for x, y in zip(a, b)] if a else None
+        for key in STATS_GAUGES:
+            v = self.call('stats_get', 'string:' + key)
+            result['stats'][key] = v if isinstance(v, int) else None
+        for stage in FRAME_STAGES:
+            result['stage_avg_us'][stage] = self.call(
+                'timing_get', 'string:' + stage, 'string:avg')
+        return result
+
+    def stop(self):
+        # compton cleans up on SIGINT, the rest can just go
+        for p in reversed(self.procs):
+            if p.poll() is None:
+                p.send_signal(signal.SIGINT if p is getattr(self, 'compton', None)
+                              else signal.SIGTERM)
+        for p in reversed(self.procs):
+            try:
+                p.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                p.kill()
+                p.wait()
+
+
+def run_scenario(args, path):
+    with open(path) as f:
+        scenario = json.load(f)
+    name = scenario.get('name', os.path.splitext(os.path.basename(path))[0])
+    duration = args.duration or scenario.get('duration', 10)
+    report = {'name': name, 'scenario': scenario}
+
+    with tempfile.TemporaryDirectory(prefix='compton-bench-') as tmpdir:
+        session = Session(args, scenario, tmpdir)
+        report['screen'] = session.screen
+        try:
+            session.start_xvfb()
+            session.start_dbus()
+            session.start_compton()
+            session.start_workload()
+            report.update(session.measure(duration))
+        except BenchError as e:
+            report['error'] = str(e)
+        finally:
+            session.stop()
+            if 'error' in report and os.path.exists(
+                    getattr(session, 'log', '')):
+                with open(session.log) as f:
+                    report['compton_log'] = f.read()[-4096:]
+    return report
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run compton benchmark scenarios in Xvfb.')
+    parser.add_argument('scenarios', nargs='*',
+                        help='scenario files, defaults to all in scenarios/')
+    parser.add_argument('--compton', help='compton binary to benchmark')
+    parser.add_argument('--workload', help='workload client binary, built '
+                        'from workload.c if not given')
+    parser.add_argument('-o', '--output', help='file to write the report '
+                        'to, defaults to standard output')
+    parser.add_argument('--duration', type=float,
+                        help='seconds to measure each scenario for, '
+                        'overriding the scenarios')
+    parser.add_argument('--warmup', type=float, default=1,
+                        help='seconds to wait before measuring')
+    parser.add_argument('--screen',
+                        help='size of the Xvfb screen, overriding the '
+                        'scenarios')
+    args = parser.parse_args()
+
+    for tool in ['Xvfb', 'dbus-daemon', 'dbus-send']:
+        if not shutil.which(tool):
+            print('{} is needed to run benchmarks'.format(tool),
+                  file=sys.stderr)
+            return 77
+    scenarios = args.scenarios or sorted(
+        os.path.join(HERE, 'scenarios', f)
+        for f in os.listdir(os.path.join(HERE, 'scenarios'))
+        if f.endswith('.json'))
+
+    with tempfile.TemporaryDirectory(prefix='compton-bench-') as tmpdir:
+        try:
+            args.compton = args.compton or find_compton()
+            args.workload = args.workload or build_workload(tmpdir)
+        except BenchError as e:
+            print(e, file=sys.stderr)
+            return 1
+        reports = [run_scenario(args, s) for s in scenarios]
+
+    out = json.dumps({'compton': args.compton, 'results': reports}, indent=2)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(out + '\n')
+    else:
+        print(out)
+    return 1 if any('error' in r for r in reports) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Scripted client for benchmarking compton: creates windows with the given
+// opacity and shape, and damages them in a chosen pattern at a fixed rate.
+//
+// Everything is derived from --seed, so the same arguments always give the
+// same stream of requests. "ready" is printed once all windows are mapped,
+// and "ticks N" when the workload ends.
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <xcb/shape.h>
+#include <xcb/xcb.h>
+
+enum pattern {
+	/// Map the windows, and leave them alone
+	PATTERN_STATIC,
+	/// Fill a random rectangle of every window
+	PATTERN_DAMAGE,
+	/// Scroll the content of every window up, and fill the bottom
+	PATTERN_SCROLL,
+	/// Resize every window between its full and 3/4 size
+	PATTERN_RESIZE,
+	/// Unmap one window and map another one back
+	PATTERN_CHURN,
+};
+
+static const char *const PATTERN_NAMES[] = {
+    [PATTERN_STATIC] = "static", [PATTERN_DAMAGE] = "damage",
+    [PATTERN_SCROLL] = "scroll", [PATTERN_RESIZE] = "resize",
+    [PATTERN_CHURN] = "churn",
+};
+
+/// Lines scrolled per tick by PATTERN_SCROLL.
+#define SCROLL_STEP 8
+
+struct workload {
+	xcb_connection_t *c;
+	xcb_screen_t *screen;
+	xcb_gcontext_t gc;
+	xcb_window_t *windows;
+	int nwindows;
+	int width, height;
+	enum pattern pattern;
+	uint64_t rng;
+};
+
+/// xorshift64*, so the workload doesn't depend on the libc's rand().
+static uint32_t next_random(struct workload *wl) {
+	wl->rng ^= wl->rng >> 12;
+	wl->rng ^= wl->rng << 25;
+	wl->rng ^= wl->rng >> 27;
+	return (uint32_t)((wl->rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static int random_below(struct workload *wl, int n) {
+	return n > 0 ? (int)(next_random(wl) % (uint32_t)n) : 0;
+}
+
+static xcb_atom_t intern_atom(xcb_connection_t *c, const char *name) {
+	xcb_intern_atom_reply_t *r = xcb_intern_atom_reply(
+	    c, xcb_intern_atom(c, 0, (uint16_t)strlen(name), name), NULL);
+	xcb_atom_t atom = r ? r->atom : XCB_NONE;
+	free(r);
+	return atom;
+}
+
+/// Cut the corners of a window, like rounded corners 4 pixels wide.
+static void shape_window(struct workload *wl, xcb_window_t w) {
+	const int16_t r = 4;
+	const uint16_t width = (uint16_t)wl->width, height = (uint16_t)wl->height;
+	xcb_rectangle_t rects[] = {
+	    {0, r, width, (uint16_t)(height - 2 * r)},
+	    {r / 2, r / 2, (uint16_t)(width - r), (uint16_t)(height - r)},
+	    {r, 0, (uint16_t)(width - 2 * r), height},
+	};
+	xcb_shape_rectangles(wl->c, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING,
+	                     XCB_CLIP_ORDERING_UNSORTED, w, 0, 0,
+	                     sizeof(rects) / sizeof(rects[0]), rects);
+}
+
+static void create_windows(struct workload *wl, double opacity, bool shaped) {
+	xcb_atom_t opacity_atom = intern_atom(wl->c, "_NET_WM_WINDOW_OPACITY");
+	const char wm_class[] = "compton-bench\0compton-bench";
+	const int maxx = wl->screen->width_in_pixels - wl->width;
+	const int maxy = wl->screen->height_in_pixels - wl->height;
+
+	for (int i = 0; i < wl->nwindows; i++) {
+		xcb_window_t w = xcb_generate_id(wl->c);
+		uint32_t values[] = {next_random(wl) & 0xffffff};
+		xcb_create_window(wl->c, XCB_COPY_FROM_PARENT, w, wl->screen->root,
+		                  (int16_t)random_below(wl, maxx),
+		                  (int16_t)random_below(wl, maxy), (uint16_t)wl->width,
+		                  (uint16_t)wl->height, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+		                  XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL, values);
+		xcb_change_property(wl->c, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_CLASS,
+		                    XCB_ATOM_STRING, 8, sizeof(wm_class), wm_class);
+		if (opacity < 1) {
+			uint32_t o = (uint32_t)(opacity * 0xffffffffu);
+			xcb_change_property(wl->c, XCB_PROP_MODE_REPLACE, w,
+			                    opacity_atom, XCB_ATOM_CARDINAL, 32, 1, &o);
+		}
+		if (shaped)
+			shape_window(wl, w);
+		xcb_map_window(wl->c, w);
+		wl->windows[i] = w;
+	}
+
+	wl->gc = xcb_generate_id(wl->c);
+	uint32_t values[] = {0, 0};
+	xcb_create_gc(wl->c, wl->gc, wl->screen->root,
+	              XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, values);
+}
+
+static void fill(struct workload *wl, xcb_window_t w, xcb_rectangle_t rect) {
+	uint32_t color = next_random(wl) & 0xffffff;
+	xcb_change_gc(wl->c, wl->gc, XCB_GC_FOREGROUND, &color);
+	xcb_poly_fill_rectangle(wl->c, w, wl->gc, 1, &rect);
+}
+
+static void tick(struct workload *wl, long n) {
+	const uint16_t width = (uint16_t)wl->width, height = (uint16_t)wl->height;
+	switch (wl->pattern) {
+	case PATTERN_STATIC: break;
+	case PATTERN_DAMAGE:
+		for (int i = 0; i < wl->nwindows; i++) {
+			xcb_rectangle_t rect = {
+			    (int16_t)random_below(wl, width * 3 / 4),
+			    (int16_t)random_below(wl, height * 3 / 4), width / 4,
+			    height / 4};
+			fill(wl, wl->windows[i], rect);
+		}
+		break;
+	case PATTERN_SCROLL:
+		for (int i = 0; i < wl->nwindows; i++) {
+			xcb_window_t w = wl->windows[i];
+			xcb_copy_area(wl->c, w, w, wl->gc, 0, SCROLL_STEP, 0, 0, width,
+			              (uint16_t)(height - SCROLL_STEP));
+			fill(wl, w,
+			     (xcb_rectangle_t){0, (int16_t)(height - SCROLL_STEP),
+			                       width, SCROLL_STEP});
+		}
+		break;
+	case PATTERN_RESIZE:
+		for (int i = 0; i < wl->nwindows; i++) {
+			// Windows take turns, so they are never all the same size
+			bool small = (n + i) % 2;
+			uint32_t size[] = {small ? width * 3u / 4 : width,
+			                   small ? height * 3u / 4 : height};
+			xcb_configure_window(wl->c, wl->windows[i],
+			                     XCB_CONFIG_WINDOW_WIDTH |
+			                         XCB_CONFIG_WINDOW_HEIGHT,
+			                     size);
+		}
+		break;
+	case PATTERN_CHURN:
+		xcb_map_window(wl->c, wl->windows[(n + wl->nwindows - 1) % wl->nwindows]);
+		xcb_unmap_window(wl->c, wl->windows[n % wl->nwindows]);
+		break;
+	}
+	xcb_flush(wl->c);
+}
+
+static void usage(const char *argv0, int ret) {
+	fprintf(ret ? stderr : stdout,
+	        "Usage: %s [options]\n"
+	        "\n"
+	        "--windows N      number of windows, defaults to 10\n"
+	        "--size WxH       size of each window, defaults to 400x300\n"
+	        "--opacity F      opacity of the windows, defaults to 1\n"
+	        "--shape          cut the corners of the windows\n"
+	        "--pattern P      one of static, damage, scroll, resize and churn,\n"
+	        "                 defaults to damage\n"
+	        "--rate HZ        ticks of the pattern per second, defaults to 60\n"
+	        "--duration S     seconds to run for, defaults to 0, which runs\n"
+	        "                 until killed\n"
+	        "--seed N         seed of window placement, colors and damage\n",
+	        argv0);
+	exit(ret);
+}
+
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+	    {"windows", required_argument, NULL, 'n'},
+	    {"size", required_argument, NULL, 's'},
+	    {"opacity", required_argument, NULL, 'o'},
+	    {"shape", no_argument, NULL, 'S'},
+	    {"pattern", required_argument, NULL, 'p'},
+	    {"rate", required_argument, NULL, 'r'},
+	    {"duration", required_argument, NULL, 'd'},
+	    {"seed", required_argument, NULL, 'e'},
+	    {"help", no_argument, NULL, 'h'},
+	    {NULL, 0, NULL, 0},
+	};
+
+	struct workload wl = {
+	    .nwindows = 10, .width = 400, .height = 300, .pattern = PATTERN_DAMAGE};
+	double opacity = 1, rate = 60, duration = 0;
+	bool shaped = false;
+	unsigned long long seed = 1;
+
+	int o;
+	while ((o = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+		switch (o) {
+		case 'n': wl.nwindows = atoi(optarg); break;
+		case 's':
+			if (sscanf(optarg, "%dx%d", &wl.width, &wl.height) != 2)
+				usage(argv[0], 1);
+			break;
+		case 'o': opacity = atof(optarg); break;
+		case 'S': shaped = true; break;
+		case 'p': {
+			size_t i = 0;
+			for (; i < sizeof(PATTERN_NAMES) / sizeof(PATTERN_NAMES[0]); i++)
+				if (!strcmp(PATTERN_NAMES[i], optarg))
+					break;
+			if (i == sizeof(PATTERN_NAMES) / sizeof(PATTERN_NAMES[0]))
+				usage(argv[0], 1);
+			wl.pattern = (enum pattern)i;
+			break;
+		}
+		case 'r': rate = atof(optarg); break;
+		case 'd': duration = atof(optarg); break;
+		case 'e': seed = strtoull(optarg, NULL, 0); break;
+		case 'h': usage(argv[0], 0); break;
+		default: usage(argv[0], 1);
+		}
+	}
+	if (wl.nwindows < 1 || wl.width < 16 || wl.height < 16 || rate <= 0)
+		usage(argv[0], 1);
+	// xorshift gets stuck at 0
+	wl.rng = seed ? seed : 1;
+
+	int screen_nr;
+	wl.c = xcb_connect(NULL, &screen_nr);
+	if (xcb_connection_has_error(wl.c)) {
+		fprintf(stderr, "Cannot connect to the X server\n");
+		return 1;
+	}
+	xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(wl.c));
+	for (int i = 0; i < screen_nr; i++)
+		xcb_screen_next(&it);
+	wl.screen = it.data;
+	if (wl.width > wl.screen->width_in_pixels ||
+	    wl.height > wl.screen->height_in_pixels) {
+		fprintf(stderr, "Windows are larger than the screen\n");
+		return 1;
+	}
+
+	wl.windows = calloc((size_t)wl.nwindows, sizeof(xcb_window_t));
+	create_windows(&wl, opacity, shaped);
+	// Wait for the windows to be mapped before saying we are ready
+	free(xcb_get_input_focus_reply(wl.c, xcb_get_input_focus(wl.c), NULL));
+	printf("ready\n");
+	fflush(stdout);
+
+	const long interval = (long)(1e9 / rate);
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	const long nticks = duration > 0 ? (long)(duration * rate) : -1;
+	long n = 0;
+	for (; nticks < 0 || n < nticks; n++) {
+		if (xcb_connection_has_error(wl.c))
+			break;
+		tick(&wl, n);
+		// We don't select any events, but errors still come in
+		xcb_generic_event_t *ev;
+		while ((ev = xcb_poll_for_event(wl.c)))
+			free(ev);
+
+		next.tv_nsec += interval;
+		while (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+			;
+	}
+	printf("ticks %ld\n", n);
+
+	xcb_disconnect(wl.c);
+	free(wl.windows);
+	return 0;
+}
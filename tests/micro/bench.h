@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/// A tiny harness for the micro-benchmarks.
+///
+/// Each benchmark is a function called repeatedly. The number of calls per
+/// round is picked so a round takes at least BENCH_ROUND_NS, then the median
+/// time per call over BENCH_ROUNDS rounds is printed along with the fastest
+/// and slowest round, so noise shows up without moving the headline number.
+
+/// Number of timed rounds.
+#define BENCH_ROUNDS 11
+
+/// Shortest round, in nanoseconds.
+#define BENCH_ROUND_NS 20000000L
+
+/// Exit status that tells meson a benchmark was skipped.
+#define BENCH_SKIP 77
+
+/// Results are stored here, so the compiler can't drop the work.
+static volatile double bench_sink;
+
+static inline long bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+static inline long bench_time(void (*fn)(void *), void *data, long calls) {
+	long start = bench_now();
+	for (long i = 0; i < calls; i++)
+		fn(data);
+	return bench_now() - start;
+}
+
+static int bench_cmp(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/// Time `fn(data)`, and print the result under `name`.
+static inline void bench_run(const char *name, void (*fn)(void *), void *data) {
+	// Doubling the calls until a round is long enough also warms up the
+	// caches and the branch predictors
+	long calls = 1;
+	while (bench_time(fn, data, calls) < BENCH_ROUND_NS)
+		calls *= 2;
+
+	double per_call[BENCH_ROUNDS];
+	for (int i = 0; i < BENCH_ROUNDS; i++)
+		per_call[i] = (double)bench_time(fn, data, calls) / (double)calls;
+	qsort(per_call, BENCH_ROUNDS, sizeof(double), bench_cmp);
+
+	printf("%-44s %12.1f ns/call  (%.1f - %.1f, %ld calls/round)\n", name,
+	       per_call[BENCH_ROUNDS / 2], per_call[0], per_call[BENCH_ROUNDS - 1],
+	       calls);
+	fflush(stdout);
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Benchmarks of parsing and matching window rules
+
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "c2.h"
+#include "common.h"
+#include "log.h"
+#include "utils.h"
+#include "win.h"
+
+#include "bench.h"
+
+#define NRULES 200
+#define NWINDOWS 100
+
+struct c2_bench {
+	session_t *ps;
+	char *rules[NRULES];
+	c2_lptr_t *list;
+	win *windows[NWINDOWS];
+};
+
+/// Rules on the targets compton knows without asking the X server, in the
+/// shapes they take in real configuration files. None of them matches any
+/// of the windows, so c2_match() has to go through all of them, which is what
+/// happens for most windows with long exclusion lists.
+static char *make_rule(int i) {
+	char buf[64];
+	switch (i % 8) {
+	case 0:
+		snprintf(buf, sizeof(buf), "name = 'Untitled %d - Mozilla Firefox'", i);
+		return strdup(buf);
+	case 1: return strdup("class_g = 'Conky'");
+	case 2: return strdup("class_i *= 'notif'");
+	case 3: return strdup("name %= '*YouTube*Theatre*'");
+	case 4: return strdup("name ~= '^(Picture[- ]in[- ]picture|PiP)$'");
+	case 5: return strdup("window_type = 'dock' || window_type = 'desktop'");
+	case 6: return strdup("x < 0 && width > 4000");
+	default: return strdup("override_redirect = 1 && role ^= 'gnome-'");
+	}
+}
+
+static void bench_c2_parse(void *data) {
+	struct c2_bench *b = data;
+	c2_lptr_t *list = NULL;
+	for (int i = 0; i < NRULES; i++)
+		c2_parse(&list, b->rules[i], NULL);
+	while (list)
+		list = c2_free_lptr(list);
+}
+
+static void bench_c2_postprocess(void *data) {
+	struct c2_bench *b = data;
+	c2_lptr_t *list = NULL;
+	for (int i = 0; i < NRULES; i++)
+		c2_parse(&list, b->rules[i], NULL);
+	bench_sink = c2_list_postprocess(b->ps, list);
+	while (list)
+		list = c2_free_lptr(list);
+}
+
+static void bench_c2_match(void *data) {
+	struct c2_bench *b = data;
+	int matched = 0;
+	for (int i = 0; i < NWINDOWS; i++)
+		matched += c2_match(b->ps, b->windows[i], b->list, NULL, NULL);
+	bench_sink = matched;
+}
+
+int main(void) {
+	log_init_tls();
+
+	struct c2_bench b = {.ps = ccalloc(1, session_t)};
+	for (int i = 0; i < NRULES; i++) {
+		b.rules[i] = make_rule(i);
+		if (!c2_parse(&b.list, b.rules[i], NULL)) {
+			fprintf(stderr, "Failed to parse rule \"%s\".\n", b.rules[i]);
+			return 1;
+		}
+	}
+	if (!c2_list_postprocess(b.ps, b.list)) {
+		fprintf(stderr, "Failed to postprocess the rules.\n");
+		return 1;
+	}
+
+	const char *classes[] = {"URxvt", "Firefox", "Emacs", "mpv", "Thunar"};
+	for (int i = 0; i < NWINDOWS; i++) {
+		win *w = ccalloc(1, win);
+		w->id = (xcb_window_t)(0x1000000 + i);
+		w->client_win = w->id + 1;
+		w->a.map_state = XCB_MAP_STATE_VIEWABLE;
+		w->window_type = WINTYPE_NORMAL;
+		w->g.x = (int16_t)(i * 17 % 1600);
+		w->g.width = (uint16_t)(200 + i * 13 % 1000);
+		w->name = strdup("~/src/compton - Terminal");
+		w->class_general = strdup(classes[i % 5]);
+		w->class_instance = strdup(classes[(i + 2) % 5]);
+		w->role = strdup("browser");
+		b.windows[i] = w;
+	}
+
+	bench_run("c2_parse, 200 rules", bench_c2_parse, &b);
+	bench_run("c2_parse + c2_list_postprocess, 200 rules", bench_c2_postprocess, &b);
+	bench_run("c2_match, 200 rules x 100 windows", bench_c2_match, &b);
+
+	for (int i = 0; i < NWINDOWS; i++) {
+		win *w = b.windows[i];
+		free(w->name);
+		free(w->class_general);
+		free(w->class_instance);
+		free(w->role);
+		free(w);
+	}
+	while (b.list)
+		b.list = c2_free_lptr(b.list);
+	for (int i = 0; i < NRULES; i++)
+		free(b.rules[i]);
+	free(b.ps);
+
+	log_deinit_tls();
+	return 0;
+}
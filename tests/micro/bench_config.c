@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Benchmarks of parsing blur kernels, which is done again for every change of
+// the blur options over D-Bus
+
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/render.h>
+
+#include "config.h"
+#include "log.h"
+
+#include "bench.h"
+
+struct config_bench {
+	const char *src;
+	xcb_render_fixed_t *kerns[MAX_BLUR_PASS];
+};
+
+static void bench_parse_conv_kern_lst(void *data) {
+	struct config_bench *b = data;
+	bool hasneg;
+	// The kernels parsed by the last call are freed by this one
+	bench_sink = parse_conv_kern_lst(b->src, b->kerns, MAX_BLUR_PASS, &hasneg);
+}
+
+int main(void) {
+	log_init_tls();
+
+	// A custom 15x15 kernel, written out the way users put them in their
+	// configuration files
+	char custom[15 * 15 * 9 + 16];
+	int len = snprintf(custom, sizeof(custom), "15,15");
+	for (int i = 0; i < 15 * 15 - 1; i++)
+		len += snprintf(custom + len, sizeof(custom) - (size_t)len, ",%.6f",
+		                (double)(i % 15 + i / 15) / 28.0);
+
+	const char *srcs[] = {"3x3box", "7x7gaussian", "11x11gaussian", custom};
+	for (size_t i = 0; i < sizeof(srcs) / sizeof(srcs[0]); i++) {
+		struct config_bench b = {.src = srcs[i]};
+		bool hasneg;
+		if (!parse_conv_kern_lst(b.src, b.kerns, MAX_BLUR_PASS, &hasneg)) {
+			fprintf(stderr, "Failed to parse blur kernel.\n");
+			return 1;
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "parse_conv_kern_lst %s",
+		         b.src == custom ? "custom 15x15" : b.src);
+		bench_run(name, bench_parse_conv_kern_lst, &b);
+
+		for (int j = 0; j < MAX_BLUR_PASS; j++)
+			free(b.kerns[j]);
+	}
+
+	log_deinit_tls();
+	return 0;
+}
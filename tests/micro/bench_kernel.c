@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Benchmarks of the shadow kernel code in kernel.c
+
+#include "kernel.h"
+#include "log.h"
+
+#include "bench.h"
+
+struct kernel_bench {
+	double radius;
+	conv *kernel;
+};
+
+static void bench_gaussian_kernel(void *data) {
+	struct kernel_bench *b = data;
+	conv *k = gaussian_kernel(b->radius);
+	bench_sink = k->data[0];
+	free_conv(k);
+}
+
+static void bench_shadow_preprocess(void *data) {
+	struct kernel_bench *b = data;
+	shadow_preprocess(b->kernel);
+	bench_sink = b->kernel->rsum[0];
+}
+
+static void bench_sum_kernel(void *data) {
+	struct kernel_bench *b = data;
+	const int d = b->kernel->size;
+	double sum = 0;
+	// Every rectangle with a corner in the kernel's top left quarter, the
+	// way make_shadow() uses it for small windows
+	for (int y = 0; y < d / 2; y++)
+		for (int x = 0; x < d / 2; x++)
+			sum += sum_kernel(b->kernel, x, y, d - x, d - y);
+	bench_sink = sum;
+}
+
+static void bench_sum_kernel_normalized(void *data) {
+	struct kernel_bench *b = data;
+	const int d = b->kernel->size;
+	double sum = 0;
+	for (int y = 0; y < d / 2; y++)
+		for (int x = 0; x < d / 2; x++)
+			sum += sum_kernel_normalized(b->kernel, x, y, d - x, d - y);
+	bench_sink = sum;
+}
+
+int main(void) {
+	log_init_tls();
+
+	// 12 is the default shadow radius
+	const double radii[] = {3, 12, 36};
+	for (size_t i = 0; i < sizeof(radii) / sizeof(radii[0]); i++) {
+		struct kernel_bench b = {.radius = radii[i]};
+		b.kernel = gaussian_kernel(b.radius);
+		shadow_preprocess(b.kernel);
+
+		char name[64];
+		snprintf(name, sizeof(name), "gaussian_kernel r=%g", b.radius);
+		bench_run(name, bench_gaussian_kernel, &b);
+		snprintf(name, sizeof(name), "shadow_preprocess r=%g", b.radius);
+		bench_run(name, bench_shadow_preprocess, &b);
+		snprintf(name, sizeof(name), "sum_kernel r=%g (quarter sweep)", b.radius);
+		bench_run(name, bench_sum_kernel, &b);
+		snprintf(name, sizeof(name), "sum_kernel_normalized r=%g (quarter sweep)",
+		         b.radius);
+		bench_run(name, bench_sum_kernel_normalized, &b);
+
+		free_conv(b.kernel);
+	}
+
+	log_deinit_tls();
+	return 0;
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Benchmarks of the region operations done for every frame
+
+#include <pixman.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "region.h"
+#include "utils.h"
+
+#include "bench.h"
+
+#define NWINDOWS 64
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+
+struct region_bench {
+	/// Bounding shapes of the windows, from top to bottom
+	region_t shapes[NWINDOWS];
+	bool solid[NWINDOWS];
+	/// A region with many rectangles, for resize_region()
+	region_t scattered;
+};
+
+/// A window of w x h at (x, y), with its corners cut off like a rounded frame,
+/// so its bounding shape is a handful of rectangles.
+static void make_shape(region_t *shape, int x, int y, int w, int h) {
+	pixman_region32_init_rect(shape, x, y, (unsigned)w, (unsigned)h);
+	const int corner = 4;
+	for (int i = 0; i < corner; i++) {
+		const int cut = corner - i;
+		pixman_region32_t c;
+		pixman_region32_init_rect(&c, x, y + i, (unsigned)cut, 1);
+		pixman_region32_union_rect(&c, &c, x + w - cut, y + i, (unsigned)cut, 1);
+		pixman_region32_subtract(shape, shape, &c);
+		pixman_region32_fini(&c);
+	}
+}
+
+static void bench_init(struct region_bench *b) {
+	srand(1);
+	for (int i = 0; i < NWINDOWS; i++) {
+		int w = 100 + rand() % 900, h = 80 + rand() % 600;
+		make_shape(&b->shapes[i], rand() % (SCREEN_WIDTH - w),
+		           rand() % (SCREEN_HEIGHT - h), w, h);
+		// Most windows are opaque, a few are translucent
+		b->solid[i] = rand() % 4 != 0;
+	}
+
+	// A grid with gaps, like the damage of a terminal redrawing its text
+	pixman_region32_init(&b->scattered);
+	for (int y = 0; y < SCREEN_HEIGHT; y += 20)
+		for (int x = 0; x < SCREEN_WIDTH; x += 40)
+			pixman_region32_union_rect(&b->scattered, &b->scattered, x, y,
+			                           30, 14);
+}
+
+static void bench_fini(struct region_bench *b) {
+	for (int i = 0; i < NWINDOWS; i++)
+		pixman_region32_fini(&b->shapes[i]);
+	pixman_region32_fini(&b->scattered);
+}
+
+static void bench_resize_region(void *data) {
+	struct region_bench *b = data;
+	region_t r;
+	pixman_region32_init(&r);
+	copy_region(&r, &b->scattered);
+	// Like the blur background region is grown by the blur kernel's size
+	resize_region(&r, 5);
+	bench_sink = pixman_region32_n_rects(&r);
+	pixman_region32_fini(&r);
+}
+
+/// The reg_ignore chain built by paint_preprocess(), followed by the clipping
+/// of each window to it done by paint_all().
+static void bench_reg_ignore(void *data) {
+	struct region_bench *b = data;
+	rc_region_t *reg_ignore[NWINDOWS];
+
+	// Top to bottom, each window ignores what the solid windows above cover
+	rc_region_t *last = rc_region_new();
+	for (int i = 0; i < NWINDOWS; i++) {
+		reg_ignore[i] = rc_region_ref(last);
+		if (b->solid[i]) {
+			rc_region_t *tmp = rc_region_new();
+			pixman_region32_union(tmp, &b->shapes[i], last);
+			rc_region_unref(&last);
+			last = tmp;
+		}
+	}
+	rc_region_unref(&last);
+
+	// Bottom to top, the visible part of each window is painted
+	region_t reg_paint, part;
+	pixman_region32_init_rect(&reg_paint, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+	pixman_region32_init(&part);
+	long nrects = 0;
+	for (int i = NWINDOWS - 1; i >= 0; i--) {
+		pixman_region32_subtract(&part, &b->shapes[i], reg_ignore[i]);
+		pixman_region32_intersect(&part, &part, &reg_paint);
+		nrects += pixman_region32_n_rects(&part);
+		rc_region_unref(&reg_ignore[i]);
+	}
+	bench_sink = (double)nrects;
+	pixman_region32_fini(&part);
+	pixman_region32_fini(&reg_paint);
+}
+
+int main(void) {
+	log_init_tls();
+
+	struct region_bench b;
+	bench_init(&b);
+	bench_run("resize_region (scattered damage)", bench_resize_region, &b);
+	char name[64];
+	snprintf(name, sizeof(name), "reg_ignore chain, %d windows", NWINDOWS);
+	bench_run(name, bench_reg_ignore, &b);
+	bench_fini(&b);
+
+	log_deinit_tls();
+	return 0;
+}
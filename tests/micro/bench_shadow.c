@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
+
+// Benchmarks of make_shadow(), the shadow image generation
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_image.h>
+
+#include "backend/backend_common.h"
+#include "kernel.h"
+#include "log.h"
+
+#include "bench.h"
+
+struct shadow_bench {
+	xcb_connection_t *c;
+	conv *kernel;
+	int width, height;
+};
+
+static void bench_make_shadow(void *data) {
+	struct shadow_bench *b = data;
+	xcb_image_t *img = make_shadow(b->c, b->kernel, 0.75, b->width, b->height);
+	bench_sink = img->data[0];
+	xcb_image_destroy(img);
+}
+
+int main(void) {
+	log_init_tls();
+
+	// make_shadow() only needs the connection for the image format, but that
+	// still takes an X server
+	xcb_connection_t *c = xcb_connect(NULL, NULL);
+	if (xcb_connection_has_error(c)) {
+		fprintf(stderr, "Can't connect to the X server, skipping.\n");
+		xcb_disconnect(c);
+		log_deinit_tls();
+		return BENCH_SKIP;
+	}
+
+	struct shadow_bench b = {.c = c, .kernel = gaussian_kernel(12)};
+	shadow_preprocess(b.kernel);
+
+	// Sizes that go through each of the paths in make_shadow(): smaller than
+	// the kernel, narrower than the kernel, and large enough for the
+	// corners, edges and middle to be filled separately.
+	const int sizes[][2] = {{10, 10}, {16, 400}, {200, 100}, {800, 600}, {1920, 1080}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		b.width = sizes[i][0];
+		b.height = sizes[i][1];
+
+		char name[64];
+		snprintf(name, sizeof(name), "make_shadow %dx%d", b.width, b.height);
+		bench_run(name, bench_make_shadow, &b);
+	}
+
+	free_conv(b.kernel);
+	xcb_disconnect(c);
+	log_deinit_tls();
+	return 0;
+}